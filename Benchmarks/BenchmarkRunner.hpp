@@ -0,0 +1,235 @@
+#ifndef BENCHMARK_RUNNER_HPP
+#define BENCHMARK_RUNNER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace drone
+{
+namespace bench
+{
+/// <summary>
+/// Защита результата от удаления оптимизатором
+/// </summary>
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// <summary>
+/// Настройки запуска
+/// </summary>
+struct BenchmarkOptions
+{
+    // Наименьшее время одного замера, число операций подбирается под него
+    double min_time = 0.2;
+    // Число замеров, в отчёт идут медиана, минимум и максимум
+    std::size_t repetitions = 5;
+    // Подстрока имени, пусто - все бенчмарки
+    std::string filter;
+    // Наибольшее число производителей в бенчмарках очередей
+    std::size_t max_producers = 8;
+};
+
+/// <summary>
+/// Результат одного бенчмарка
+/// </summary>
+struct BenchmarkResult
+{
+    std::string name;
+    std::uint64_t iterations = 0; // операций в одном замере
+    std::size_t repetitions = 0;
+    double ns_median = 0.0; // нс на операцию
+    double ns_min = 0.0;
+    double ns_max = 0.0;
+    double bytes_per_op = 0.0; // 0 - бенчмарк не обрабатывает данные
+};
+
+/// <summary>
+/// Тело бенчмарка: выполняет заданное число операций
+/// </summary>
+using BenchmarkBody = std::function<void(std::uint64_t iterations)>;
+
+/// <summary>
+/// Запуск бенчмарков и запись результатов.
+/// Время замеряется вокруг всего тела, поэтому многопоточные бенчмарки
+/// сами запускают и дожидаются своих потоков.
+/// </summary>
+class BenchmarkRunner
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    BenchmarkOptions _options;
+    std::vector<BenchmarkResult> _results;
+
+public:
+    explicit BenchmarkRunner(const BenchmarkOptions& options)
+        : _options(options)
+    {
+    }
+
+    const BenchmarkOptions& options() const
+    {
+        return _options;
+    }
+
+    /// <summary>
+    /// Замер бенчмарка, если имя проходит фильтр
+    /// </summary>
+    /// <param name="bytes_per_op">Объём данных одной операции, для пропускной способности</param>
+    void run(const std::string& name, const BenchmarkBody& body, const double bytes_per_op = 0.0)
+    {
+        if (!_options.filter.empty() && name.find(_options.filter) == std::string::npos) {
+            return;
+        }
+
+        // Подбор числа операций: замер должен длиться не меньше min_time
+        std::uint64_t iterations = 1;
+        double seconds = measure(body, iterations);
+        while (seconds < _options.min_time && iterations < (std::uint64_t(1) << 40)) {
+            const double scale = seconds > 0.0 ? _options.min_time / seconds * 1.2 : 10.0;
+            iterations = std::max<std::uint64_t>(iterations + 1, static_cast<std::uint64_t>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+            seconds = measure(body, iterations);
+        }
+
+        std::vector<double> samples;
+        samples.reserve(_options.repetitions);
+        samples.push_back(seconds);
+        for (std::size_t i = 1; i < _options.repetitions; ++i) {
+            samples.push_back(measure(body, iterations));
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchmarkResult result;
+        result.name = name;
+        result.iterations = iterations;
+        result.repetitions = samples.size();
+        const double per_op = 1e9 / static_cast<double>(iterations);
+        result.ns_median = samples[samples.size() / 2] * per_op;
+        result.ns_min = samples.front() * per_op;
+        result.ns_max = samples.back() * per_op;
+        result.bytes_per_op = bytes_per_op;
+        print(result);
+        _results.push_back(result);
+    }
+
+    const std::vector<BenchmarkResult>& results() const
+    {
+        return _results;
+    }
+
+    /// <summary>
+    /// Запись результатов в JSON
+    /// </summary>
+    /// <returns>false при ошибке записи</returns>
+    bool writeJson(const std::string& path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out << "{\n  \"context\": {\n"
+            << "    \"date\": \"" << timestamp() << "\",\n"
+            << "    \"compiler\": \"" << compiler() << "\",\n"
+            << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"min_time\": " << _options.min_time << ",\n"
+            << "    \"repetitions\": " << _options.repetitions << "\n"
+            << "  },\n  \"benchmarks\": [";
+        out << std::setprecision(6) << std::fixed;
+        for (std::size_t i = 0; i < _results.size(); ++i) {
+            const BenchmarkResult& r = _results[i];
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\"name\": \"" << r.name << "\""
+                << ", \"iterations\": " << r.iterations
+                << ", \"repetitions\": " << r.repetitions
+                << ", \"ns_per_op\": " << r.ns_median
+                << ", \"ns_per_op_min\": " << r.ns_min
+                << ", \"ns_per_op_max\": " << r.ns_max
+                << ", \"ops_per_second\": " << (r.ns_median > 0.0 ? 1e9 / r.ns_median : 0.0);
+            if (r.bytes_per_op > 0.0) {
+                out << ", \"bytes_per_second\": " << (r.ns_median > 0.0 ? r.bytes_per_op * 1e9 / r.ns_median : 0.0);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    static double measure(const BenchmarkBody& body, const std::uint64_t iterations)
+    {
+        const Clock::time_point started = Clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(Clock::now() - started).count();
+    }
+
+    static void print(const BenchmarkResult& r)
+    {
+        std::ostringstream line;
+        line << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(1)
+             << std::setw(14) << r.ns_median << " ns/op"
+             << "  [" << r.ns_min << " .. " << r.ns_max << "]";
+        if (r.bytes_per_op > 0.0 && r.ns_median > 0.0) {
+            line << std::setprecision(1) << "  " << r.bytes_per_op / r.ns_median * 1e9 / (1024.0 * 1024.0) << " MiB/s";
+        }
+        std::cout << line.str() << '\n';
+    }
+
+    static std::string timestamp()
+    {
+        const std::time_t now = std::time(nullptr);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        char text[32] = {};
+        std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        return text;
+    }
+
+    static std::string compiler()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+};
+
+// Наборы бенчмарков, по одному на файл
+
+void registerLogBenchmarks(BenchmarkRunner& runner);
+void registerQueueBenchmarks(BenchmarkRunner& runner);
+void registerWireBenchmarks(BenchmarkRunner& runner);
+#ifdef DRONE_BENCH_TRANSCODE
+void registerTranscodeBenchmarks(BenchmarkRunner& runner);
+#endif
+}
+}
+
+#endif
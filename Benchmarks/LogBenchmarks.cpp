@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "AsyncLog.hpp"
+#include "BenchmarkRunner.hpp"
+
+namespace drone
+{
+namespace bench
+{
+void registerLogBenchmarks(BenchmarkRunner& runner)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "drone_bench.blog";
+    AsyncLogSettings settings;
+    settings.path = path.string();
+    settings.level = LogLevel::Info;
+    settings.console_level = LogLevel::Off;
+    settings.ring_capacity = 4 * 1024 * 1024;
+    settings.drain_interval = std::chrono::milliseconds(1);
+    AsyncLog& log = AsyncLog::instance();
+    log.start(settings);
+
+    // Сообщение ниже порога: одна проверка уровня
+    runner.run("log/filtered", [](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            DRONE_LOG_DEBUG("Получено сообщение, размер: {}", i);
+        }
+    });
+
+    // Запись в кольцо потока; при переполнении кольца сообщение теряется,
+    // что тоже входит в стоимость вызова
+    runner.run("log/enqueue_int", [](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            DRONE_LOG_INFO("Получено сообщение, размер: {}", i);
+        }
+    });
+
+    const std::string text = "Exception raised by the API";
+    runner.run("log/enqueue_mixed", [&text](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            DRONE_LOG_INFO("Точка маршрута {} не достигнута, расстояние: {} ({})", i, 1.5, text);
+        }
+    });
+
+    log.stop();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+
+    // Форматирование, которое журнал переносит в поток выгрузки
+    std::byte args[64];
+    std::byte* out = args;
+    logArgWrite(out, std::uint64_t(17));
+    logArgWrite(out, 1.5);
+    logArgWrite(out, text);
+    const std::size_t size = static_cast<std::size_t>(out - args);
+    runner.run("log/format", [&args, size](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            std::string message = formatLogMessage("Точка маршрута {} не достигнута, расстояние: {} ({})", args, size);
+            doNotOptimize(message);
+        }
+    });
+}
+}
+}
@@ -0,0 +1,109 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchmarkRunner.hpp"
+#include "RingMessageQueue.hpp"
+#include "SafeMessageQueue.hpp"
+
+namespace drone
+{
+namespace bench
+{
+namespace
+{
+// Ёмкость кольцевой очереди как у очередей сообщений сервера (MSG_QUEUE_CAPACITY)
+constexpr std::size_t RING_CAPACITY = 256;
+
+/// <summary>
+/// Передача iterations сообщений от producers потоков одному потребителю
+/// </summary>
+template <typename Push, typename Pop>
+void producersToConsumer(const std::uint64_t iterations, const std::size_t producers, Push push, Pop pop)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (std::size_t p = 0; p < producers; ++p) {
+        std::uint64_t count = iterations / producers;
+        if (p == 0) {
+            count += iterations % producers;
+        }
+        threads.emplace_back([count, &push]() {
+            for (std::uint64_t i = 0; i < count; ++i) {
+                push(i);
+            }
+        });
+    }
+
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        sum += pop();
+    }
+    doNotOptimize(sum);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/// <summary>
+/// Число производителей: 1, 2, 4 ... до max_producers
+/// </summary>
+std::vector<std::size_t> producerCounts(const std::size_t max_producers)
+{
+    std::vector<std::size_t> counts;
+    for (std::size_t n = 1; n < max_producers; n *= 2) {
+        counts.push_back(n);
+    }
+    counts.push_back(max_producers);
+    return counts;
+}
+}
+
+void registerQueueBenchmarks(BenchmarkRunner& runner)
+{
+    // Один поток: стоимость пары push/pop без конкуренции
+    runner.run("safe_queue/push_pop_single_thread", [](const std::uint64_t iterations) {
+        SafeMessageQueue<std::uint64_t> queue;
+        std::uint64_t sum = 0;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            queue.push(i);
+            sum += queue.pop();
+        }
+        doNotOptimize(sum);
+    });
+
+    runner.run("ring_queue/push_pop_single_thread", [](const std::uint64_t iterations) {
+        RingMessageQueue<std::uint64_t> queue(RING_CAPACITY);
+        std::uint64_t sum = 0;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            queue.push(std::uint64_t(i));
+            sum += *queue.pop();
+        }
+        doNotOptimize(sum);
+    });
+
+    // Несколько производителей и один потребитель, как потоки приёма и цикл сообщений сервера
+    for (const std::size_t producers : producerCounts(runner.options().max_producers)) {
+        const std::string suffix = "/producers_" + std::to_string(producers);
+
+        runner.run("safe_queue/mpsc" + suffix, [producers](const std::uint64_t iterations) {
+            SafeMessageQueue<std::uint64_t> queue;
+            producersToConsumer(
+                iterations, producers,
+                [&queue](const std::uint64_t value) { queue.push(value); },
+                [&queue]() { return queue.pop(); });
+        });
+
+        runner.run("ring_queue/mpsc" + suffix, [producers](const std::uint64_t iterations) {
+            RingMessageQueue<std::uint64_t> queue(RING_CAPACITY);
+            producersToConsumer(
+                iterations, producers,
+                [&queue](const std::uint64_t value) { queue.push(std::uint64_t(value)); },
+                [&queue]() { return *queue.pop(); });
+        });
+    }
+}
+}
+}
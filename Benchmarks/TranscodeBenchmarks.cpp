@@ -0,0 +1,105 @@
+#include <QBuffer>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QImage>
+#include <QPainter>
+
+#include "BenchmarkRunner.hpp"
+#include "FrameDecoder/framedecoder.h"
+
+namespace drone
+{
+namespace bench
+{
+namespace
+{
+constexpr int FRAME_WIDTH = 640;
+constexpr int FRAME_HEIGHT = 480;
+
+/// <summary>
+/// Изображение, похожее на кадр камеры: градиент неба и земли с деталями,
+/// чтобы PNG и JPEG сжимались не лучше реальных кадров
+/// </summary>
+QImage makeScene()
+{
+    QImage image(FRAME_WIDTH, FRAME_HEIGHT, QImage::Format_RGB32);
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < FRAME_WIDTH; ++x) {
+            const int noise = ((x * 7919 + y * 104729) >> 3) & 0x0f;
+            line[x] = y < FRAME_HEIGHT / 2
+                ? qRgb(90 + y / 8, 140 + y / 8, 230 - noise)
+                : qRgb(70 + ((x / 16 + y / 16) & 1) * 40 + noise, 110 + noise, 60);
+        }
+    }
+    return image;
+}
+
+QByteArray encode(const QImage& image, const char* format)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, format);
+    return bytes;
+}
+
+ImageFrameHeader frameHeader(const ImageEncoding encoding, const int size)
+{
+    ImageFrameHeader header;
+    header.width = FRAME_WIDTH;
+    header.height = FRAME_HEIGHT;
+    header.encoding = encoding;
+    header.payload_size = static_cast<std::uint32_t>(size);
+    return header;
+}
+}
+
+void registerTranscodeBenchmarks(BenchmarkRunner& runner)
+{
+    // Плагин JPEG загружается через QCoreApplication
+    static int argc = 1;
+    static char name[] = "drone_benchmarks";
+    static char* argv[] = { name, nullptr };
+    QCoreApplication app(argc, argv);
+
+    const QImage scene = makeScene();
+    const QByteArray png = encode(scene, "PNG");
+    QByteArray bgr(FRAME_WIDTH * FRAME_HEIGHT * 3, Qt::Uninitialized);
+    for (int y = 0; y < FRAME_HEIGHT; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(scene.constScanLine(y));
+        for (int x = 0; x < FRAME_WIDTH; ++x) {
+            char* pixel = bgr.data() + (y * FRAME_WIDTH + x) * 3;
+            pixel[0] = static_cast<char>(qBlue(line[x]));
+            pixel[1] = static_cast<char>(qGreen(line[x]));
+            pixel[2] = static_cast<char>(qRed(line[x]));
+        }
+    }
+
+    // Путь ImageServer::slotSave: декодирование кадра и сжатие в JPEG
+    const ImageFrameHeader png_header = frameHeader(ImageEncoding::Png, png.size());
+    runner.run("transcode/png_to_jpeg_640x480", [&png, &png_header](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            const QByteArray jpeg = FrameDecoder::toJpeg(png, png_header);
+            doNotOptimize(jpeg.size());
+        }
+    }, static_cast<double>(png.size()));
+
+    const ImageFrameHeader bgr_header = frameHeader(ImageEncoding::Bgr8, bgr.size());
+    runner.run("transcode/bgr_to_jpeg_640x480", [&bgr, &bgr_header](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            const QByteArray jpeg = FrameDecoder::toJpeg(bgr, bgr_header);
+            doNotOptimize(jpeg.size());
+        }
+    }, static_cast<double>(bgr.size()));
+
+    // Составляющие: только декодирование PNG
+    runner.run("transcode/png_decode_640x480", [&png, &png_header](const std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            const QImage image = FrameDecoder::decode(png, png_header);
+            doNotOptimize(image.width());
+        }
+    }, static_cast<double>(png.size()));
+}
+}
+}
@@ -0,0 +1,157 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "BenchmarkRunner.hpp"
+#include "BufferPool.hpp"
+#include "CameraFrame.hpp"
+#include "DroneRpc.hpp"
+#include "DroneWire.hpp"
+#include "LatencyStats.hpp"
+
+namespace drone
+{
+namespace bench
+{
+namespace
+{
+/// <summary>
+/// Последние значения сенсоров, копируются в ответ так же, как DroneTelemetry::latest
+/// </summary>
+struct TelemetrySnapshot
+{
+    mutable std::mutex mtx;
+    BarometerSensorDataRep barometer;
+    ImuSensorDataRep imu;
+    GpsSensorDataRep gps{};
+    MagnetometerSensorDataRep magnetometer;
+
+    void latest(DroneReply& reply) const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        reply.barometer = barometer;
+        reply.imu = imu;
+        reply.gps = gps;
+        reply.magnetometer = magnetometer;
+    }
+};
+
+/// <summary>
+/// Кадр камеры с изображением заданного размера
+/// </summary>
+CameraFrame makeFrame(const std::size_t image_size)
+{
+    CameraFrame frame;
+    frame.camera = DroneCamera::front_center;
+    frame.sequence = 42;
+    frame.time_stamp = 1234567890;
+    frame.width = 640;
+    frame.height = 480;
+    frame.encoding = ImageEncoding::Jpeg;
+    frame.bytes.assign(image_size, std::uint8_t(0x5a));
+    return frame;
+}
+}
+
+void registerWireBenchmarks(BenchmarkRunner& runner)
+{
+    // Разбор запроса в цикле сообщений: заголовок протокола и чтение полей на месте
+    {
+        DroneMethodReq request;
+        request.method = DroneMethods::ToForward;
+        request.request_id = 7;
+        request.vehicle_id = 1;
+        std::vector<std::byte> framed(wireSize<DroneMethodReq>());
+        encodeWire(framed.data(), WireKind::Request, request);
+        std::vector<std::byte> legacy(sizeof(DroneMethodReq));
+        std::memcpy(legacy.data(), &request, sizeof(request));
+
+        runner.run("wire/request_decode", [framed](const std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                const std::optional<WireMessage<DroneMethodReqView>> message =
+                    decodeWire<DroneMethodReqView>(framed.data(), framed.size(), WireKind::Request);
+                const DroneMethodReqView& body = message->body;
+                const std::uint64_t fields = static_cast<std::uint64_t>(body.method()) + body.request_id()
+                                             + body.vehicle_id() + body.get_camera_image();
+                doNotOptimize(fields);
+            }
+        }, static_cast<double>(framed.size()));
+
+        runner.run("wire/request_decode_legacy", [legacy](const std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                const std::optional<WireMessage<DroneMethodReqView>> message =
+                    decodeWire<DroneMethodReqView>(legacy.data(), legacy.size(), WireKind::Request);
+                const DroneMethodReqView& body = message->body;
+                const std::uint64_t fields = static_cast<std::uint64_t>(body.method()) + body.request_id()
+                                             + body.vehicle_id() + body.get_camera_image();
+                doNotOptimize(fields);
+            }
+        }, static_cast<double>(legacy.size()));
+    }
+
+    // Ответ как в DroneApplication::makeResponseControl: буфер из пула,
+    // заголовок и тело, показания сенсоров под блокировкой телеметрии
+    runner.run("wire/reply_encode", [](const std::uint64_t iterations) {
+        ReplyBufferPool pool(4);
+        TelemetrySnapshot telemetry;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            ReplyBuffer buffer = pool.acquire();
+            DroneReply* reply = encodeReply(buffer, DroneMethods::ToForward, true, static_cast<std::uint32_t>(i),
+                                            ReplyStatus::Accepted, 0);
+            telemetry.latest(*reply);
+            doNotOptimize(buffer.data());
+        }
+    }, static_cast<double>(wireSize<DroneReply>()));
+
+    // Кадр камеры: заголовок из кадра и сборка сообщения, как в цикле отправки кадров
+    {
+        const CameraFrame frame = makeFrame(0);
+        runner.run("frame/header_encode", [frame](const std::uint64_t iterations) {
+            std::byte message[sizeof(ImageFrameHeader)];
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                const ImageFrameHeader header = toFrameHeader(frame);
+                std::memcpy(message, &header, sizeof(header));
+                doNotOptimize(message);
+            }
+        }, static_cast<double>(sizeof(ImageFrameHeader)));
+    }
+    for (const std::size_t image_size : { std::size_t(64 * 1024), std::size_t(640 * 480 * 3) }) {
+        const CameraFrame frame = makeFrame(image_size);
+        runner.run("frame/encode_" + std::to_string(image_size / 1024) + "k", [&frame](const std::uint64_t iterations) {
+            std::vector<std::byte> message(sizeof(ImageFrameHeader) + frame.bytes.size());
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                const ImageFrameHeader header = toFrameHeader(frame);
+                encodeFrame(message.data(), header, frame.bytes.data());
+                doNotOptimize(message.data());
+            }
+        }, static_cast<double>(sizeof(ImageFrameHeader) + image_size));
+    }
+
+    // Проверка заголовка принятого кадра на клиенте
+    {
+        const CameraFrame frame = makeFrame(64 * 1024);
+        const ImageFrameHeader header = toFrameHeader(frame);
+        std::vector<std::byte> message(frameSize(header));
+        encodeFrame(message.data(), header, frame.bytes.data());
+        runner.run("frame/header_parse", [message](const std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                const std::optional<ImageFrameHeader> parsed = decodeFrameHeader(message.data(), message.size());
+                doNotOptimize(parsed->sequence);
+            }
+        }, static_cast<double>(sizeof(ImageFrameHeader)));
+    }
+
+    // Учёт задержки в гистограмме статистики сервера
+    runner.run("stats/histogram_record", [](const std::uint64_t iterations) {
+        LatencyHistogram histogram;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            histogram.record((i * 2654435761u) & 0xFFFFF);
+        }
+        doNotOptimize(histogram.count());
+    });
+}
+}
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "BenchmarkRunner.hpp"
+
+namespace
+{
+void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --out <file>          JSON results (default: benchmark_results.json)\n"
+              << "  --filter <substring>  run only benchmarks whose name contains the substring\n"
+              << "  --min-time <seconds>  minimal duration of one measurement (default: 0.2)\n"
+              << "  --repetitions <n>     measurements per benchmark (default: 5)\n"
+              << "  --max-producers <n>   producer threads in queue benchmarks (default: 8)\n";
+}
+}
+
+int main(int argc, char* argv[])
+{
+    drone::bench::BenchmarkOptions options;
+    std::string out_path = "benchmark_results.json";
+
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            options.filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && has_value) {
+            options.min_time = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) {
+            options.repetitions = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (std::strcmp(argv[i], "--max-producers") == 0 && has_value) {
+            options.max_producers = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    drone::bench::BenchmarkRunner runner(options);
+    drone::bench::registerLogBenchmarks(runner);
+    drone::bench::registerQueueBenchmarks(runner);
+    drone::bench::registerWireBenchmarks(runner);
+#ifdef DRONE_BENCH_TRANSCODE
+    drone::bench::registerTranscodeBenchmarks(runner);
+#endif
+
+    if (!runner.writeJson(out_path)) {
+        std::cerr << "Cannot write " << out_path << "\n";
+        return 1;
+    }
+    std::cout << "Results: " << out_path << '\n';
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef AIRSIM_CONNECTION_POOL_HPP
+#define AIRSIM_CONNECTION_POOL_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DroneBackend.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Назначение rpc соединения с AirSim
+/// </summary>
+enum class AirSimRole : int
+{
+    Command = 0, // команды управления
+    Camera,      // захват изображений
+    Telemetry,   // опрос сенсоров
+    Depth        // кадры глубины для оценки расстояний
+};
+
+constexpr std::size_t AIRSIM_ROLE_COUNT = 4;
+
+/// <summary>
+/// Пул rpc соединений с AirSim: отдельное соединение на каждую роль,
+/// чтобы захват изображений, опрос сенсоров и команды не ждали друг друга
+/// на одном rpclib клиенте. Каждое соединение используется из своего потока.
+/// Для захвата изображений открывается несколько соединений, чтобы держать
+/// в работе несколько запросов simGetImages одновременно.
+/// Соединения создаются фабрикой источника: AirSim или запись полёта.
+/// </summary>
+class AirSimConnectionPool
+{
+private:
+    std::array<std::unique_ptr<DroneBackend>, AIRSIM_ROLE_COUNT> _clients;
+    std::vector<std::unique_ptr<DroneBackend>> _camera_clients; // дополнительные соединения камер
+
+public:
+    /// <summary>
+    /// Открытие соединений для всех ролей
+    /// </summary>
+    /// <param name="factory">Создание соединения с источником</param>
+    /// <param name="camera_connections">Число соединений для захвата изображений</param>
+    /// <param name="vehicle_name">Имя дрона, для которого открываются соединения</param>
+    explicit AirSimConnectionPool(const DroneBackendFactory& factory,
+                                  const std::size_t camera_connections = 1,
+                                  const std::string& vehicle_name = "")
+    {
+        for (std::unique_ptr<DroneBackend>& client : _clients) {
+            client = factory(vehicle_name);
+        }
+        for (std::size_t i = 1; i < camera_connections; ++i) {
+            _camera_clients.push_back(factory(vehicle_name));
+        }
+    }
+
+    AirSimConnectionPool(const AirSimConnectionPool&) = delete;
+    AirSimConnectionPool& operator=(const AirSimConnectionPool&) = delete;
+
+    /// <summary>
+    /// Клиент AirSim для роли
+    /// </summary>
+    /// <param name="index">Номер соединения для роли Camera</param>
+    DroneBackend& client(const AirSimRole role, const std::size_t index = 0)
+    {
+        if (role == AirSimRole::Camera && index > 0) {
+            return *_camera_clients.at(index - 1);
+        }
+        return *_clients[static_cast<std::size_t>(role)];
+    }
+
+    /// <summary>
+    /// Число соединений для захвата изображений
+    /// </summary>
+    std::size_t cameraConnections() const
+    {
+        return _camera_clients.size() + 1;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,807 @@
+#ifndef ASYNC_LOG_HPP
+#define ASYNC_LOG_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Уровень сообщения журнала
+/// </summary>
+enum class LogLevel : std::uint8_t
+{
+    Trace = 0,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off // только для порога: ничего не записывается
+};
+
+inline const char* logLevelName(const LogLevel level)
+{
+    static const char* const names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+    const std::size_t index = static_cast<std::size_t>(level);
+    return index < sizeof(names) / sizeof(names[0]) ? names[index] : "?";
+}
+
+/// <summary>
+/// Уровень по имени: trace, debug, info, warn, error, off
+/// </summary>
+/// <returns>false, если имя неизвестно</returns>
+inline bool parseLogLevel(const std::string& name, LogLevel& level)
+{
+    static const char* const names[] = { "trace", "debug", "info", "warn", "error", "off" };
+    for (std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (name == names[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Формат двоичного журнала: заголовок файла, затем записи LogEntryHeader
+// с данными. Строка формата и место вызова записываются один раз (Site),
+// сообщение хранит только номер места вызова, время и значения аргументов.
+
+constexpr char LOG_FILE_MAGIC[8] = { 'D', 'R', 'N', 'B', 'L', 'O', 'G', '\0' };
+constexpr std::uint16_t LOG_FILE_VERSION = 1;
+// Строковые аргументы длиннее обрезаются
+constexpr std::size_t LOG_MAX_STRING = 1024;
+
+enum class LogEntryKind : std::uint8_t
+{
+    Site = 1, // LogSiteEntry, имя файла и строка формата
+    Record,   // LogRecordEntry и аргументы
+    Dropped   // LogDroppedEntry: сообщения потока, потерянные при переполнении буфера
+};
+
+enum class LogArgType : std::uint8_t
+{
+    Int = 1, // int64
+    UInt,    // uint64
+    Double,
+    Bool,    // uint8
+    String   // uint16 длина и байты
+};
+
+#pragma pack(push, 1)
+struct LogFileHeader
+{
+    char magic[8] = { 'D', 'R', 'N', 'B', 'L', 'O', 'G', '\0' };
+    std::uint16_t version = LOG_FILE_VERSION;
+    std::uint16_t header_size = sizeof(LogFileHeader);
+    std::uint32_t reserved = 0;
+    std::int64_t start_time_ns = 0; // системное время нулевой отметки сообщений, нс от эпохи
+};
+
+struct LogEntryHeader
+{
+    LogEntryKind kind = LogEntryKind::Record;
+    std::uint8_t reserved[3] = {};
+    std::uint32_t size = 0; // размер данных после заголовка
+};
+
+struct LogSiteEntry
+{
+    std::uint32_t site_id = 0;
+    std::uint32_t line = 0;
+    LogLevel level = LogLevel::Info;
+    std::uint16_t file_size = 0;
+    std::uint16_t format_size = 0;
+};
+
+struct LogRecordEntry
+{
+    std::uint32_t site_id = 0;
+    std::uint32_t thread_id = 0;
+    std::uint64_t time_ns = 0; // от нулевой отметки журнала
+    LogLevel level = LogLevel::Info;
+};
+
+struct LogDroppedEntry
+{
+    std::uint32_t thread_id = 0;
+    std::uint64_t count = 0;
+    std::uint64_t time_ns = 0;
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Место вызова: уровень, файл, строка и строка формата с подстановками {}.
+/// Создаётся статической переменной в макросе журнала.
+/// </summary>
+struct LogSite
+{
+    LogLevel level;
+    const char* file;
+    int line;
+    const char* format = nullptr;
+    std::atomic<std::uint32_t> id{ 0 }; // 0 - ещё не зарегистрировано
+};
+
+// Кодирование аргументов сообщения
+
+template <typename T>
+std::size_t logArgSize(const T& value)
+{
+    using Type = std::decay_t<T>;
+    if constexpr (std::is_same_v<Type, bool>) {
+        return 1 + 1;
+    }
+    else if constexpr (std::is_integral_v<Type> || std::is_enum_v<Type>) {
+        return 1 + 8;
+    }
+    else if constexpr (std::is_floating_point_v<Type>) {
+        return 1 + 8;
+    }
+    else if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+        return 1 + 2 + std::min(std::string_view(value).size(), LOG_MAX_STRING);
+    }
+    else {
+        static_assert(std::is_pointer_v<Type>, "unsupported log argument type");
+        return 1 + 8;
+    }
+}
+
+template <typename T>
+void logArgWrite(std::byte*& out, const T& value)
+{
+    using Type = std::decay_t<T>;
+    const auto put = [&out](const LogArgType type, const void* data, const std::size_t size) {
+        *out++ = static_cast<std::byte>(type);
+        std::memcpy(out, data, size);
+        out += size;
+    };
+    if constexpr (std::is_same_v<Type, bool>) {
+        const std::uint8_t flag = value ? 1 : 0;
+        put(LogArgType::Bool, &flag, sizeof(flag));
+    }
+    else if constexpr (std::is_enum_v<Type>) {
+        logArgWrite(out, static_cast<std::underlying_type_t<Type>>(value));
+    }
+    else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+        const std::int64_t number = value;
+        put(LogArgType::Int, &number, sizeof(number));
+    }
+    else if constexpr (std::is_integral_v<Type>) {
+        const std::uint64_t number = value;
+        put(LogArgType::UInt, &number, sizeof(number));
+    }
+    else if constexpr (std::is_floating_point_v<Type>) {
+        const double number = static_cast<double>(value);
+        put(LogArgType::Double, &number, sizeof(number));
+    }
+    else if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+        const std::string_view text(value);
+        const std::uint16_t size = static_cast<std::uint16_t>(std::min(text.size(), LOG_MAX_STRING));
+        *out++ = static_cast<std::byte>(LogArgType::String);
+        std::memcpy(out, &size, sizeof(size));
+        std::memcpy(out + sizeof(size), text.data(), size);
+        out += sizeof(size) + size;
+    }
+    else {
+        const std::uint64_t address = reinterpret_cast<std::uintptr_t>(value);
+        put(LogArgType::UInt, &address, sizeof(address));
+    }
+}
+
+/// <summary>
+/// Подстановка аргументов в строку формата: {} заменяется очередным аргументом,
+/// лишние аргументы дописываются в конец
+/// </summary>
+inline std::string formatLogMessage(const char* format, const std::byte* args, const std::size_t size)
+{
+    std::string text;
+    const std::byte* const end = args + size;
+    const auto next = [&args, end, &text]() -> bool {
+        if (args >= end) {
+            return false;
+        }
+        const LogArgType type = static_cast<LogArgType>(*args++);
+        char number[32];
+        switch (type) {
+        case LogArgType::Int: {
+            std::int64_t value = 0;
+            std::memcpy(&value, args, sizeof(value));
+            args += sizeof(value);
+            std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+            text += number;
+            return true;
+        }
+        case LogArgType::UInt: {
+            std::uint64_t value = 0;
+            std::memcpy(&value, args, sizeof(value));
+            args += sizeof(value);
+            std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+            text += number;
+            return true;
+        }
+        case LogArgType::Double: {
+            double value = 0.0;
+            std::memcpy(&value, args, sizeof(value));
+            args += sizeof(value);
+            std::snprintf(number, sizeof(number), "%g", value);
+            text += number;
+            return true;
+        }
+        case LogArgType::Bool:
+            text += *args++ != std::byte{ 0 } ? "true" : "false";
+            return true;
+        case LogArgType::String: {
+            std::uint16_t length = 0;
+            std::memcpy(&length, args, sizeof(length));
+            args += sizeof(length);
+            text.append(reinterpret_cast<const char*>(args), length);
+            args += length;
+            return true;
+        }
+        }
+        args = end; // повреждённые данные
+        return false;
+    };
+
+    for (const char* p = format != nullptr ? format : ""; *p != '\0'; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (!next()) {
+                text += "{}";
+            }
+            ++p;
+        }
+        else {
+            text += *p;
+        }
+    }
+    while (args < end) {
+        text += ' ';
+        next();
+    }
+    return text;
+}
+
+/// <summary>
+/// Время сообщения для вывода: ЧЧ:ММ:СС.ммм по местному времени
+/// </summary>
+inline std::string formatLogTime(const std::int64_t unix_ns)
+{
+    const std::time_t seconds = static_cast<std::time_t>(unix_ns / 1000000000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char text[32] = {};
+    const std::size_t length = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(text + length, sizeof(text) - length, ".%03d", static_cast<int>((unix_ns / 1000000) % 1000));
+    return text;
+}
+
+/// <summary>
+/// Байтовое кольцо сообщений одного потока: пишет только этот поток,
+/// читает только поток выгрузки журнала, без блокировок.
+/// Сообщение - 4 байта размера и данные, выровнено на 8 байт.
+/// </summary>
+class LogRing
+{
+private:
+    static constexpr std::uint32_t WRAP = 0xFFFFFFFFu; // остаток кольца пропускается
+
+    std::unique_ptr<std::byte[]> _data;
+    std::size_t _capacity;
+    std::size_t _mask;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _head{ 0 }; // запись
+    std::size_t _reserved = 0;                                    // размер зарезервированного сообщения
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail{ 0 }; // чтение
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> _dropped{ 0 };
+    std::atomic<bool> _detached{ false }; // поток завершён
+
+public:
+    const std::uint32_t thread_id;
+
+    LogRing(std::size_t capacity, const std::uint32_t thread)
+        : thread_id(thread)
+    {
+        // Ёмкость - степень двойки не меньше 4 КиБ
+        std::size_t size = 4096;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _capacity = size;
+        _mask = size - 1;
+        _data = std::make_unique<std::byte[]>(size);
+    }
+
+    /// <summary>
+    /// Место под сообщение, вызывается только потоком-владельцем
+    /// </summary>
+    /// <returns>nullptr, если кольцо заполнено (сообщение теряется)</returns>
+    std::byte* reserve(const std::size_t size)
+    {
+        const std::size_t total = (sizeof(std::uint32_t) + size + 7) & ~std::size_t(7);
+        if (total > _capacity / 4) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        const std::size_t free = _capacity - (head - _tail.load(std::memory_order_acquire));
+        std::size_t pos = head & _mask;
+        const std::size_t contiguous = _capacity - pos;
+        const std::size_t needed = contiguous < total ? contiguous + total : total;
+        if (needed > free) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (contiguous < total) {
+            std::memcpy(_data.get() + pos, &WRAP, sizeof(WRAP));
+            head += contiguous;
+            pos = 0;
+        }
+        const std::uint32_t stored = static_cast<std::uint32_t>(size);
+        std::memcpy(_data.get() + pos, &stored, sizeof(stored));
+        _reserved = head + total;
+        return _data.get() + pos + sizeof(std::uint32_t);
+    }
+
+    /// <summary>
+    /// Публикация сообщения, записанного в reserve
+    /// </summary>
+    void commit()
+    {
+        _head.store(_reserved, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Чтение всех опубликованных сообщений, вызывается только потоком выгрузки
+    /// </summary>
+    template <typename Callback>
+    void consume(Callback on_message)
+    {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        const std::size_t head = _head.load(std::memory_order_acquire);
+        while (tail < head) {
+            const std::size_t pos = tail & _mask;
+            std::uint32_t size = 0;
+            std::memcpy(&size, _data.get() + pos, sizeof(size));
+            if (size == WRAP) {
+                tail += _capacity - pos;
+                continue;
+            }
+            on_message(_data.get() + pos + sizeof(size), static_cast<std::size_t>(size));
+            tail += (sizeof(size) + size + 7) & ~std::size_t(7);
+        }
+        _tail.store(tail, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t takeDropped()
+    {
+        return _dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    void detach()
+    {
+        _detached.store(true, std::memory_order_release);
+    }
+
+    bool detached() const
+    {
+        return _detached.load(std::memory_order_acquire);
+    }
+};
+
+/// <summary>
+/// Настройки журнала
+/// </summary>
+struct AsyncLogSettings
+{
+    // Двоичный журнал, пусто - только вывод в консоль
+    std::string path;
+    // Порог записи в файл
+    LogLevel level = LogLevel::Debug;
+    // Порог вывода в консоль (форматирует поток выгрузки)
+    LogLevel console_level = LogLevel::Info;
+    // Кольцо каждого пишущего потока
+    std::size_t ring_capacity = 64 * 1024;
+    // Период выгрузки колец в файл и консоль
+    std::chrono::milliseconds drain_interval{ 10 };
+};
+
+/// <summary>
+/// Асинхронный журнал. Вызывающий поток только копирует номер места вызова,
+/// время и значения аргументов в своё кольцо; форматирование, запись
+/// в файл и в консоль выполняет фоновый поток. Сообщения ниже порога
+/// отсекаются одним чтением атомарной переменной.
+/// До start() и после stop() сообщения сразу выводятся в stderr.
+/// </summary>
+class AsyncLog
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// <summary>
+    /// Кольцо текущего потока, отмечается завершённым при выходе потока
+    /// </summary>
+    struct ThreadRing
+    {
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing()
+        {
+            if (ring) {
+                ring->detach();
+            }
+        }
+    };
+
+    const Clock::time_point _epoch = Clock::now();
+    std::atomic<LogLevel> _threshold{ LogLevel::Info };
+    std::atomic<LogLevel> _file_level{ LogLevel::Off };
+    std::atomic<LogLevel> _console_level{ LogLevel::Info };
+    std::atomic<bool> _running{ false };
+    AsyncLogSettings _settings;
+
+    std::mutex _mtx;
+    std::condition_variable _cond_var;
+    std::vector<std::shared_ptr<LogRing>> _rings;
+    std::vector<const LogSite*> _sites;
+    std::uint32_t _next_thread_id = 0;
+    bool _stopping = false;
+    std::FILE* _file = nullptr;
+    std::thread _drain;
+
+    // Вывод без фонового потока
+    std::mutex _direct_mtx;
+
+public:
+    static AsyncLog& instance()
+    {
+        static AsyncLog log;
+        return log;
+    }
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    ~AsyncLog()
+    {
+        stop();
+    }
+
+    /// <summary>
+    /// Запуск фонового потока и открытие файла журнала
+    /// </summary>
+    /// <returns>false, если файл не создан (вывод в консоль продолжается)</returns>
+    bool start(const AsyncLogSettings& settings = AsyncLogSettings())
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_running) {
+            return true;
+        }
+        _settings = settings;
+        _stopping = false;
+
+        bool opened = true;
+        if (!settings.path.empty()) {
+            _file = std::fopen(settings.path.c_str(), "wb");
+            if (_file == nullptr) {
+                std::fprintf(stderr, "Ошибка создания журнала: %s\n", settings.path.c_str());
+                opened = false;
+            }
+            else {
+                std::setvbuf(_file, nullptr, _IOFBF, 1 << 16);
+                LogFileHeader header;
+                const auto system_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                header.start_time_ns = system_now - static_cast<std::int64_t>(now());
+                std::fwrite(&header, sizeof(header), 1, _file);
+                // Места вызова, зарегистрированные до открытия файла
+                for (const LogSite* site : _sites) {
+                    writeSite(*site);
+                }
+            }
+        }
+
+        _file_level = _file != nullptr ? settings.level : LogLevel::Off;
+        _console_level = settings.console_level;
+        updateThreshold();
+        _running = true;
+        _drain = std::thread(&AsyncLog::drainLoop, this);
+        return opened;
+    }
+
+    /// <summary>
+    /// Выгрузка оставшихся сообщений и остановка фонового потока
+    /// </summary>
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (!_running) {
+                return;
+            }
+            _running = false;
+            _stopping = true;
+        }
+        _cond_var.notify_all();
+        if (_drain.joinable()) {
+            _drain.join();
+        }
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_file != nullptr) {
+            std::fclose(_file);
+            _file = nullptr;
+        }
+        _file_level = LogLevel::Off;
+        updateThreshold();
+    }
+
+    /// <summary>
+    /// Порог записи в файл, меняется во время работы.
+    /// Применяется и к сообщениям, ещё не выгруженным из колец.
+    /// </summary>
+    void setLevel(const LogLevel level)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_file != nullptr) {
+            _file_level = level;
+        }
+        _settings.level = level;
+        updateThreshold();
+    }
+
+    /// <summary>
+    /// Порог вывода в консоль, меняется во время работы
+    /// </summary>
+    void setConsoleLevel(const LogLevel level)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _console_level = level;
+        _settings.console_level = level;
+        updateThreshold();
+    }
+
+    /// <summary>
+    /// Проверка порога до вычисления аргументов
+    /// </summary>
+    bool enabled(const LogLevel level) const
+    {
+        return level >= _threshold.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Запись сообщения, вызывается макросами DRONE_LOG_*
+    /// </summary>
+    template <typename... Args>
+    void write(LogSite& site, const char* format, const Args&... args)
+    {
+        std::uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = registerSite(site, format);
+        }
+
+        const std::size_t size = sizeof(LogRecordEntry) + (std::size_t(0) + ... + logArgSize(args));
+        LogRecordEntry entry;
+        entry.site_id = id;
+        entry.time_ns = now();
+        entry.level = site.level;
+
+        if (!_running.load(std::memory_order_acquire)) {
+            std::vector<std::byte> record(size);
+            [[maybe_unused]] std::byte* out = record.data() + sizeof(entry);
+            (logArgWrite(out, args), ...);
+            writeDirect(site, record.data() + sizeof(entry), size - sizeof(entry));
+            return;
+        }
+
+        LogRing* ring = threadRing();
+        [[maybe_unused]] std::byte* out = ring->reserve(size);
+        if (out == nullptr) {
+            return;
+        }
+        entry.thread_id = ring->thread_id;
+        std::memcpy(out, &entry, sizeof(entry));
+        out += sizeof(entry);
+        (logArgWrite(out, args), ...);
+        ring->commit();
+    }
+
+private:
+    AsyncLog() = default;
+
+    std::uint64_t now() const
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _epoch).count());
+    }
+
+    /// <summary>
+    /// Общий порог - наименьший из порогов файла и консоли (вызывается под блокировкой)
+    /// </summary>
+    void updateThreshold()
+    {
+        _threshold = std::min(_file_level.load(), _console_level.load());
+    }
+
+    std::uint32_t registerSite(LogSite& site, const char* format)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        std::uint32_t id = site.id.load(std::memory_order_relaxed);
+        if (id == 0) {
+            site.format = format;
+            _sites.push_back(&site);
+            id = static_cast<std::uint32_t>(_sites.size());
+            site.id.store(id, std::memory_order_release);
+            if (_file != nullptr) {
+                writeSite(site);
+            }
+        }
+        return id;
+    }
+
+    LogRing* threadRing()
+    {
+        thread_local ThreadRing thread_ring;
+        if (!thread_ring.ring) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            thread_ring.ring = std::make_shared<LogRing>(_settings.ring_capacity, ++_next_thread_id);
+            _rings.push_back(thread_ring.ring);
+        }
+        return thread_ring.ring.get();
+    }
+
+    /// <summary>
+    /// Запись места вызова в файл (вызывается под блокировкой).
+    /// Сообщения в кольцах могут попасть в файл раньше своего места вызова,
+    /// поэтому расшифровка сначала читает все места вызова.
+    /// </summary>
+    void writeSite(const LogSite& site)
+    {
+        const std::size_t file_size = std::min<std::size_t>(std::strlen(site.file), 0xFFFF);
+        const std::size_t format_size = std::min<std::size_t>(std::strlen(site.format), 0xFFFF);
+        LogSiteEntry entry;
+        entry.site_id = site.id.load(std::memory_order_relaxed);
+        entry.line = static_cast<std::uint32_t>(site.line);
+        entry.level = site.level;
+        entry.file_size = static_cast<std::uint16_t>(file_size);
+        entry.format_size = static_cast<std::uint16_t>(format_size);
+        LogEntryHeader header;
+        header.kind = LogEntryKind::Site;
+        header.size = static_cast<std::uint32_t>(sizeof(entry) + file_size + format_size);
+        std::fwrite(&header, sizeof(header), 1, _file);
+        std::fwrite(&entry, sizeof(entry), 1, _file);
+        std::fwrite(site.file, 1, file_size, _file);
+        std::fwrite(site.format, 1, format_size, _file);
+    }
+
+    void writeDirect(const LogSite& site, const std::byte* args, const std::size_t size)
+    {
+        if (site.level < _console_level.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const std::string text = formatLogMessage(site.format, args, size);
+        std::lock_guard<std::mutex> lock(_direct_mtx);
+        std::fprintf(stderr, "%s\n", text.c_str());
+    }
+
+    /// <summary>
+    /// Цикл выгрузки колец
+    /// </summary>
+    void drainLoop()
+    {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        std::vector<const LogSite*> sites;
+        std::string console;
+        bool stopping = false;
+        while (!stopping) {
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _cond_var.wait_for(lock, _settings.drain_interval, [this]() { return _stopping; });
+                stopping = _stopping;
+                rings = _rings;
+                sites = _sites;
+            }
+
+            const LogLevel file_level = _file_level.load(std::memory_order_relaxed);
+            const LogLevel console_level = _console_level.load(std::memory_order_relaxed);
+            for (const std::shared_ptr<LogRing>& ring : rings) {
+                ring->consume([&](const std::byte* data, const std::size_t size) {
+                    LogRecordEntry entry;
+                    std::memcpy(&entry, data, sizeof(entry));
+                    if (_file != nullptr && entry.level >= file_level) {
+                        LogEntryHeader header;
+                        header.kind = LogEntryKind::Record;
+                        header.size = static_cast<std::uint32_t>(size);
+                        std::fwrite(&header, sizeof(header), 1, _file);
+                        std::fwrite(data, 1, size, _file);
+                    }
+                    if (entry.level >= console_level) {
+                        if (entry.site_id > sites.size()) {
+                            std::lock_guard<std::mutex> lock(_mtx);
+                            sites = _sites;
+                        }
+                        const LogSite* site = entry.site_id <= sites.size() ? sites[entry.site_id - 1] : nullptr;
+                        console += formatLogMessage(site != nullptr ? site->format : "?", data + sizeof(entry), size - sizeof(entry));
+                        console += '\n';
+                    }
+                });
+
+                const std::uint64_t dropped = ring->takeDropped();
+                if (dropped > 0) {
+                    if (_file != nullptr) {
+                        LogDroppedEntry entry;
+                        entry.thread_id = ring->thread_id;
+                        entry.count = dropped;
+                        entry.time_ns = now();
+                        LogEntryHeader header;
+                        header.kind = LogEntryKind::Dropped;
+                        header.size = sizeof(entry);
+                        std::fwrite(&header, sizeof(header), 1, _file);
+                        std::fwrite(&entry, sizeof(entry), 1, _file);
+                    }
+                    if (LogLevel::Warning >= console_level) {
+                        console += "Журнал: потеряно сообщений потока " + std::to_string(ring->thread_id)
+                                   + ": " + std::to_string(dropped) + "\n";
+                    }
+                }
+            }
+
+            if (!console.empty()) {
+                std::lock_guard<std::mutex> lock(_direct_mtx);
+                std::fwrite(console.data(), 1, console.size(), stderr);
+                console.clear();
+            }
+            if (_file != nullptr) {
+                std::fflush(_file);
+            }
+
+            // Кольца завершённых потоков удаляются после выгрузки
+            std::lock_guard<std::mutex> lock(_mtx);
+            _rings.erase(std::remove_if(_rings.begin(), _rings.end(),
+                                        [](const std::shared_ptr<LogRing>& ring) { return ring->detached() && ring->empty(); }),
+                         _rings.end());
+        }
+    }
+};
+}
+
+/// <summary>
+/// Сообщение журнала: DRONE_LOG(LogLevel::Info, "Дрон {}: {}", id, name).
+/// Аргументы вычисляются, только если уровень проходит порог.
+/// </summary>
+#define DRONE_LOG(level, ...)                                                              \
+    do {                                                                                   \
+        if (::drone::AsyncLog::instance().enabled(level)) {                                \
+            static ::drone::LogSite drone_log_site{ level, __FILE__, __LINE__ };           \
+            ::drone::AsyncLog::instance().write(drone_log_site, __VA_ARGS__);              \
+        }                                                                                  \
+    } while (false)
+
+#define DRONE_LOG_TRACE(...) DRONE_LOG(::drone::LogLevel::Trace, __VA_ARGS__)
+#define DRONE_LOG_DEBUG(...) DRONE_LOG(::drone::LogLevel::Debug, __VA_ARGS__)
+#define DRONE_LOG_INFO(...) DRONE_LOG(::drone::LogLevel::Info, __VA_ARGS__)
+#define DRONE_LOG_WARN(...) DRONE_LOG(::drone::LogLevel::Warning, __VA_ARGS__)
+#define DRONE_LOG_ERROR(...) DRONE_LOG(::drone::LogLevel::Error, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "DroneRpc.hpp"
+#include "DroneWire.hpp"
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Пул заранее выделенных буферов фиксированного размера.
+/// Буфер возвращается в пул при уничтожении дескриптора, поэтому
+/// в установившемся режиме выделений памяти в куче нет.
+/// </summary>
+template <std::size_t BufferSize>
+class BufferPool
+{
+private:
+    struct Slot
+    {
+        alignas(std::max_align_t) std::byte data[BufferSize];
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    RingMessageQueue<Slot*> _free_slots;
+
+public:
+    /// <summary>
+    /// Дескриптор буфера из пула (только перемещение)
+    /// </summary>
+    class Buffer
+    {
+    private:
+        BufferPool* _pool = nullptr;
+        Slot* _slot = nullptr;
+        std::size_t _length = BufferSize; // занятая часть буфера
+
+    public:
+        Buffer() = default;
+
+        Buffer(BufferPool* pool, Slot* slot)
+            : _pool(pool),
+              _slot(slot)
+        {
+        }
+
+        Buffer(Buffer&& other) noexcept
+            : _pool(std::exchange(other._pool, nullptr)),
+              _slot(std::exchange(other._slot, nullptr)),
+              _length(std::exchange(other._length, BufferSize))
+        {
+        }
+
+        Buffer& operator=(Buffer&& other) noexcept
+        {
+            if (this != &other) {
+                release();
+                _pool = std::exchange(other._pool, nullptr);
+                _slot = std::exchange(other._slot, nullptr);
+                _length = std::exchange(other._length, BufferSize);
+            }
+            return *this;
+        }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        ~Buffer()
+        {
+            release();
+        }
+
+        std::byte* data()
+        {
+            return _slot != nullptr ? _slot->data : nullptr;
+        }
+
+        const std::byte* data() const
+        {
+            return _slot != nullptr ? _slot->data : nullptr;
+        }
+
+        static constexpr std::size_t size()
+        {
+            return BufferSize;
+        }
+
+        /// <summary>
+        /// Размер данных для отправки, по умолчанию весь буфер
+        /// </summary>
+        std::size_t length() const
+        {
+            return _length;
+        }
+
+        void setLength(const std::size_t length)
+        {
+            _length = length < BufferSize ? length : BufferSize;
+        }
+
+        explicit operator bool() const
+        {
+            return _slot != nullptr;
+        }
+
+        /// <summary>
+        /// Создание структуры непосредственно в буфере
+        /// </summary>
+        template <typename T, typename... Args>
+        T* emplace(Args&&... args)
+        {
+            return emplace_at<T>(0, std::forward<Args>(args)...);
+        }
+
+        /// <summary>
+        /// Создание структуры в буфере по смещению (для упакованных структур)
+        /// </summary>
+        template <typename T, typename... Args>
+        T* emplace_at(const std::size_t offset, Args&&... args)
+        {
+            static_assert(sizeof(T) <= BufferSize, "T does not fit into the buffer");
+            static_assert(std::is_trivially_destructible<T>::value, "T must be trivially destructible");
+            return new (_slot->data + offset) T(std::forward<Args>(args)...);
+        }
+
+    private:
+        void release()
+        {
+            if (_pool != nullptr && _slot != nullptr) {
+                _pool->recycle(_slot);
+            }
+            _pool = nullptr;
+            _slot = nullptr;
+        }
+    };
+
+    /// <summary>
+    /// Создание пула
+    /// </summary>
+    /// <param name="count">Число буферов в пуле</param>
+    explicit BufferPool(std::size_t count)
+        : _slots(new Slot[count]),
+          _free_slots(count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            Slot* slot = &_slots[i];
+            _free_slots.try_push(std::move(slot));
+        }
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// <summary>
+    /// Получение буфера, с ожиданием освобождения, если пул исчерпан
+    /// </summary>
+    Buffer acquire()
+    {
+        std::optional<Slot*> slot = _free_slots.pop();
+        return slot ? Buffer(this, *slot) : Buffer();
+    }
+
+    /// <summary>
+    /// Получение буфера без ожидания
+    /// </summary>
+    Buffer try_acquire()
+    {
+        std::optional<Slot*> slot = _free_slots.try_pop();
+        return slot ? Buffer(this, *slot) : Buffer();
+    }
+
+    /// <summary>
+    /// Число свободных буферов
+    /// </summary>
+    std::size_t available() const
+    {
+        return _free_slots.size();
+    }
+
+private:
+    void recycle(Slot* slot)
+    {
+        _free_slots.try_push(std::move(slot));
+    }
+};
+
+/// <summary>
+/// Пул буферов ответа, размер буфера точно равен ответу с заголовком протокола
+/// </summary>
+using ReplyBufferPool = BufferPool<wireSize<DroneReply>()>;
+using ReplyBuffer = ReplyBufferPool::Buffer;
+
+/// <summary>
+/// Запись ответа на команду в буфер из пула, показания сенсоров заполняет вызывающий
+/// </summary>
+/// <param name="framed">false - ответ старого формата без заголовка</param>
+/// <param name="payload_size">Размер данных, отправляемых после тела ответа</param>
+/// <returns>Тело ответа в буфере</returns>
+inline DroneReply* encodeReply(ReplyBuffer& buffer,
+                               const DroneMethods method,
+                               const bool framed,
+                               const std::uint32_t request_id,
+                               const ReplyStatus status,
+                               const std::uint8_t vehicle_id,
+                               const std::size_t payload_size = 0)
+{
+    std::size_t body_offset = 0;
+    if (framed) {
+        body_offset = encodeWireHeader<DroneReply>(buffer.data(), WireKind::Reply, payload_size) - buffer.data();
+    }
+    DroneReply* reply = buffer.emplace_at<DroneReply>(body_offset);
+    buffer.setLength(body_offset + sizeof(DroneReply));
+    reply->method = method;
+    reply->request_id = request_id;
+    reply->status = status;
+    reply->vehicle_id = vehicle_id;
+    return reply;
+}
+}
+
+#endif
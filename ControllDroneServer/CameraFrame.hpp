@@ -0,0 +1,53 @@
+#ifndef CAMERA_FRAME_HPP
+#define CAMERA_FRAME_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "DroneRpc.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Захваченный кадр камеры, не зависящий от типов AirSim
+/// </summary>
+struct CameraFrame
+{
+    DroneCamera camera = DroneCamera::front_center;
+    std::uint64_t sequence = 0;
+    std::uint64_t time_stamp = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    ImageEncoding encoding = ImageEncoding::Png;
+    std::uint8_t vehicle_id = 0;
+    std::float_t position[3] = {};
+    std::float_t orientation[4] = {};
+    std::vector<std::uint8_t> bytes;
+    // Момент получения кадра от источника, для учёта задержки отправки
+    std::chrono::steady_clock::time_point captured{};
+};
+
+/// <summary>
+/// Заголовок кадра для передачи клиенту
+/// </summary>
+inline ImageFrameHeader toFrameHeader(const CameraFrame& frame)
+{
+    ImageFrameHeader header;
+    header.sequence = frame.sequence;
+    header.time_stamp = frame.time_stamp;
+    header.camera = frame.camera;
+    header.width = frame.width;
+    header.height = frame.height;
+    header.encoding = frame.encoding;
+    header.vehicle_id = frame.vehicle_id;
+    std::memcpy(header.position, frame.position, sizeof(header.position));
+    std::memcpy(header.orientation, frame.orientation, sizeof(header.orientation));
+    header.payload_size = static_cast<std::uint32_t>(frame.bytes.size());
+    return header;
+}
+}
+
+#endif
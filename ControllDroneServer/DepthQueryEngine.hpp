@@ -0,0 +1,394 @@
+#ifndef DEPTH_QUERY_ENGINE_HPP
+#define DEPTH_QUERY_ENGINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DRONE_DEPTH_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "AsyncLog.hpp"
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Внутренние параметры камеры
+/// </summary>
+struct CameraIntrinsics
+{
+    float fx = 0.0f; // фокусное расстояние по оси x, пиксели
+    float fy = 0.0f; // фокусное расстояние по оси y, пиксели
+    float cx = 0.0f; // центр по оси x
+    float cy = 0.0f; // центр по оси y
+
+    /// <summary>
+    /// Параметры по размеру кадра и горизонтальному углу обзора (как в settings.json)
+    /// </summary>
+    static CameraIntrinsics fromFov(const int width, const int height, const float fov_degrees)
+    {
+        constexpr float PI = 3.14159265358979f;
+        const float fx = static_cast<float>(width) / (2.0f * std::tan(fov_degrees * PI / 360.0f));
+        return { fx, fx, static_cast<float>(width) / 2.0f, static_cast<float>(height) / 2.0f };
+    }
+};
+
+/// <summary>
+/// Область кадра для оценки глубины
+/// </summary>
+struct PixelRoi
+{
+    float x = 0.0f;        // центр области, пиксели
+    float y = 0.0f;
+    int half_size = 2;     // полуразмер квадратного окна, 0 - один пиксель
+    // x, y - смещение от центра кадра, нормированное на половину размера кадра, -1..1.
+    // Так задаются области клиента: размер кадра глубины ему не известен
+    bool normalized = false;
+};
+
+/// <summary>
+/// Результат оценки глубины для области
+/// </summary>
+struct DepthSample
+{
+    bool valid = false;
+    float depth = 0.0f;    // глубина вдоль оптической оси, м
+    float distance = 0.0f; // расстояние от камеры до точки, м
+    float x = 0.0f;        // точка в системе камеры, м
+    float y = 0.0f;
+    float z = 0.0f;
+    int pixels = 0;        // число достоверных пикселей в области
+};
+
+/// <summary>
+/// Запрос глубины, выполняемый в потоке движка
+/// </summary>
+struct DepthJob
+{
+    DroneCamera camera = DroneCamera::front_center;
+    std::vector<PixelRoi> rois;
+    DepthEstimator estimator = DepthEstimator::Median;
+    // Вызывается в потоке движка с результатом для каждой области
+    std::function<void(std::vector<DepthSample>&&)> on_complete;
+};
+
+/// <summary>
+/// Пакетная оценка глубины по областям кадра.
+/// Последний кадр глубины каждой камеры кэшируется, поэтому несколько
+/// запросов в пределах срока жизни кадра используют один вызов simGetImages.
+/// Параметры камеры берутся из фактического размера кадра и угла обзора камеры.
+/// Запросы клиентов выполняются в отдельном потоке, чтобы вызов AirSim
+/// не задерживал цикл сообщений сервера.
+/// </summary>
+class DepthQueryEngine
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct DepthFrame
+    {
+        Clock::time_point fetched{};
+        int width = 0;
+        int height = 0;
+        std::vector<float> depth;
+        CameraIntrinsics intrinsics;
+        float fov_degrees = 0.0f; // 0 - угол обзора ещё не запрошен
+    };
+
+    DroneBackend& _client;
+    Clock::duration _max_frame_age;
+    float _max_depth;
+    std::mutex _mtx;
+    std::array<DepthFrame, CAMERA_COUNT> _frames;
+    std::vector<float> _scratch;
+
+    // Ёмкость очереди запросов: при переполнении новый запрос отклоняется
+    static constexpr std::size_t JOB_QUEUE_CAPACITY = 16;
+    RingMessageQueue<DepthJob> _jobs{ JOB_QUEUE_CAPACITY };
+    std::thread _worker;
+
+public:
+    /// <summary>
+    /// Создание движка
+    /// </summary>
+    /// <param name="client">Клиент AirSim для запросов глубины</param>
+    /// <param name="max_frame_age">Срок жизни кэшированного кадра</param>
+    /// <param name="max_depth">Глубина, начиная с которой пиксель считается фоном, м</param>
+    explicit DepthQueryEngine(DroneBackend& client,
+                              const std::chrono::milliseconds max_frame_age = std::chrono::milliseconds(50),
+                              const float max_depth = 1000.0f)
+        : _client(client),
+          _max_frame_age(max_frame_age),
+          _max_depth(max_depth)
+    {
+        _worker = std::thread(&DepthQueryEngine::loop, this);
+    }
+
+    ~DepthQueryEngine()
+    {
+        stop();
+    }
+
+    DepthQueryEngine(const DepthQueryEngine&) = delete;
+    DepthQueryEngine& operator=(const DepthQueryEngine&) = delete;
+
+    /// <summary>
+    /// Постановка запроса в очередь потока движка
+    /// </summary>
+    /// <returns>false, если очередь заполнена или движок остановлен</returns>
+    bool submit(DepthJob&& job)
+    {
+        return _jobs.try_push(std::move(job));
+    }
+
+    /// <summary>
+    /// Остановка потока: запросы, уже стоящие в очереди, выполняются
+    /// </summary>
+    void stop()
+    {
+        _jobs.close();
+        if (_worker.joinable()) {
+            _worker.join();
+        }
+    }
+
+    /// <summary>
+    /// Оценка глубины для набора областей одного кадра
+    /// </summary>
+    /// <param name="camera">Камера</param>
+    /// <param name="rois">Области кадра</param>
+    /// <param name="estimator">Способ оценки</param>
+    /// <returns>Результат для каждой области в том же порядке</returns>
+    std::vector<DepthSample> query(const DroneCamera camera,
+                                   const std::vector<PixelRoi>& rois,
+                                   const DepthEstimator estimator = DepthEstimator::Median)
+    {
+        std::vector<DepthSample> samples(rois.size());
+        std::lock_guard<std::mutex> lock(_mtx);
+        const DepthFrame* frame = latestFrame(camera);
+        if (frame == nullptr) {
+            return samples;
+        }
+
+        for (std::size_t i = 0; i < rois.size(); ++i) {
+            samples[i] = sample(*frame, rois[i], estimator);
+        }
+        return samples;
+    }
+
+    /// <summary>
+    /// Расстояние от камеры до объекта в точке кадра
+    /// </summary>
+    /// <returns>Расстояние, м; отрицательное, если глубина недостоверна</returns>
+    double distanceToObject(const DroneCamera camera, const std::pair<float, float>& object_center_pixel)
+    {
+        const std::vector<DepthSample> samples = query(camera, { { object_center_pixel.first, object_center_pixel.second } });
+        return samples.front().valid ? samples.front().distance : -1.0;
+    }
+
+    /// <summary>
+    /// Сброс кэша: следующий запрос получит новый кадр
+    /// </summary>
+    void invalidate()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        for (DepthFrame& frame : _frames) {
+            frame.fetched = Clock::time_point{};
+        }
+    }
+
+private:
+    /// <summary>
+    /// Цикл выполнения запросов клиентов
+    /// </summary>
+    void loop()
+    {
+        while (std::optional<DepthJob> job = _jobs.pop()) {
+            std::vector<DepthSample> samples = query(job->camera, job->rois, job->estimator);
+            if (job->on_complete) {
+                job->on_complete(std::move(samples));
+            }
+        }
+    }
+
+    /// <summary>
+    /// Кадр глубины из кэша или новый, если кэш устарел
+    /// </summary>
+    const DepthFrame* latestFrame(const DroneCamera camera)
+    {
+        DepthFrame& frame = _frames[static_cast<std::size_t>(camera)];
+        const Clock::time_point now = Clock::now();
+        if (!frame.depth.empty() && now - frame.fetched < _max_frame_age) {
+            return &frame;
+        }
+
+        const std::string& camera_name = map_cameras.at(camera);
+        try {
+            if (frame.fov_degrees <= 0.0f) {
+                frame.fov_degrees = _client.cameraInfo(camera_name).fov;
+            }
+
+            std::vector<ImageResponse> responses = _client.cameraPixelsDepth(camera_name);
+            if (responses.empty()) {
+                return nullptr;
+            }
+            ImageResponse& response = responses.front();
+            const std::size_t pixels = static_cast<std::size_t>(response.width) * static_cast<std::size_t>(response.height);
+            if (pixels == 0 || response.image_data_float.size() < pixels) {
+                DRONE_LOG_WARN("Неожиданный размер кадра глубины: {}", response.image_data_float.size());
+                return nullptr;
+            }
+
+            if (frame.width != response.width || frame.height != response.height) {
+                frame.intrinsics = CameraIntrinsics::fromFov(response.width, response.height, frame.fov_degrees);
+            }
+            frame.width = response.width;
+            frame.height = response.height;
+            frame.depth = std::move(response.image_data_float);
+            frame.fetched = now;
+            return &frame;
+        }
+        catch (...) {
+            DRONE_LOG_ERROR("Ошибка получения кадра глубины: {}", backendErrorMessage());
+            return nullptr;
+        }
+    }
+
+    /// <summary>
+    /// Оценка глубины в области и перевод в точку системы камеры
+    /// </summary>
+    DepthSample sample(const DepthFrame& frame, const PixelRoi& roi, const DepthEstimator estimator)
+    {
+        DepthSample result;
+        const CameraIntrinsics& k = frame.intrinsics;
+        const float px = roi.normalized ? k.cx * (1.0f + roi.x) : roi.x;
+        const float py = roi.normalized ? k.cy * (1.0f + roi.y) : roi.y;
+        const int cx = static_cast<int>(std::lround(px));
+        const int cy = static_cast<int>(std::lround(py));
+        const int half = std::max(0, roi.half_size);
+        const int x0 = std::max(0, cx - half);
+        const int x1 = std::min(frame.width - 1, cx + half);
+        const int y0 = std::max(0, cy - half);
+        const int y1 = std::min(frame.height - 1, cy + half);
+        if (x0 > x1 || y0 > y1) {
+            return result;
+        }
+
+        // Копирование окна построчно в непрерывный буфер
+        const std::size_t row = static_cast<std::size_t>(x1 - x0 + 1);
+        _scratch.resize(row * static_cast<std::size_t>(y1 - y0 + 1));
+        for (int y = y0; y <= y1; ++y) {
+            std::memcpy(_scratch.data() + row * static_cast<std::size_t>(y - y0),
+                        frame.depth.data() + static_cast<std::size_t>(y) * frame.width + x0,
+                        row * sizeof(float));
+        }
+
+        const std::size_t valid = rejectInvalid(_scratch.data(), _scratch.size(), _max_depth);
+        if (valid == 0) {
+            return result;
+        }
+
+        const float depth = estimator == DepthEstimator::Median
+            ? median(_scratch.data(), _scratch.size(), valid)
+            : trimmedMean(_scratch.data(), _scratch.size(), valid);
+
+        result.valid = true;
+        result.depth = depth;
+        result.x = (px - k.cx) / k.fx * depth;
+        result.y = (py - k.cy) / k.fy * depth;
+        result.z = depth;
+        result.distance = std::sqrt(result.x * result.x + result.y * result.y + result.z * result.z);
+        result.pixels = static_cast<int>(valid);
+        return result;
+    }
+
+    /// <summary>
+    /// Замена недостоверных значений (NaN, не больше 0, дальше max_depth) на +inf
+    /// </summary>
+    /// <returns>Число достоверных значений</returns>
+    static std::size_t rejectInvalid(float* values, const std::size_t count, const float max_depth)
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        std::size_t valid = 0;
+        std::size_t i = 0;
+#ifdef DRONE_DEPTH_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 limit = _mm_set1_ps(max_depth);
+        const __m128 infs = _mm_set1_ps(inf);
+        for (; i + 4 <= count; i += 4) {
+            const __m128 v = _mm_loadu_ps(values + i);
+            // Сравнения с NaN ложны, поэтому NaN тоже отбрасывается
+            const __m128 ok = _mm_and_ps(_mm_cmpgt_ps(v, zero), _mm_cmplt_ps(v, limit));
+            _mm_storeu_ps(values + i, _mm_or_ps(_mm_and_ps(ok, v), _mm_andnot_ps(ok, infs)));
+            const int mask = _mm_movemask_ps(ok);
+            valid += static_cast<std::size_t>((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+        }
+#endif
+        for (; i < count; ++i) {
+            if (values[i] > 0.0f && values[i] < max_depth) {
+                ++valid;
+            }
+            else {
+                values[i] = inf;
+            }
+        }
+        return valid;
+    }
+
+    /// <summary>
+    /// Медиана достоверных значений (недостоверные равны +inf и уходят в конец)
+    /// </summary>
+    static float median(float* values, const std::size_t count, const std::size_t valid)
+    {
+        float* mid = values + valid / 2;
+        std::nth_element(values, mid, values + count);
+        return *mid;
+    }
+
+    /// <summary>
+    /// Среднее по средней половине достоверных значений
+    /// </summary>
+    static float trimmedMean(float* values, const std::size_t count, const std::size_t valid)
+    {
+        const std::size_t lo = valid / 4;
+        const std::size_t hi = valid - valid / 4;
+        std::nth_element(values, values + lo, values + count);
+        if (hi > lo + 1) {
+            std::nth_element(values + lo + 1, values + hi - 1, values + count);
+        }
+
+        const std::size_t n = hi - lo;
+        const float* v = values + lo;
+        float sum = 0.0f;
+        std::size_t i = 0;
+#ifdef DRONE_DEPTH_SSE2
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            acc = _mm_add_ps(acc, _mm_loadu_ps(v + i));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+        for (; i < n; ++i) {
+            sum += v[i];
+        }
+        return sum / static_cast<float>(n);
+    }
+};
+}
+
+#endif
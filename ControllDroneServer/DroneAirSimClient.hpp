@@ -14,205 +14,433 @@ STRICT_MODE_ON
 #include <iostream>
 #include <chrono>
 #include <math.h>
+#include <limits>
+#include <mutex>
 
-using namespace msr::airlib;
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
 
-typedef ImageCaptureBase::ImageRequest ImageRequest;
-typedef ImageCaptureBase::ImageResponse ImageResponse;
-typedef ImageCaptureBase::ImageType ImageType;
 typedef common_utils::FileSystem FileSystem;
 
 namespace drone
 {
 /// <summary>
-/// AirSim 
+/// Порт rpc сервера AirSim по умолчанию
 /// </summary>
-class DroneAirSimClient
+constexpr std::uint16_t AIRSIM_RPC_PORT = 41451;
+
+inline BarometerSensorDataRep toBarometerRep(const BarometerBase::Output& data)
+{
+    return {
+        data.time_stamp,
+        data.altitude,
+        data.pressure,
+        data.qnh
+    };
+}
+
+inline ImuSensorDataRep toImuRep(const ImuBase::Output& data)
+{
+    return {
+        data.time_stamp,
+        data.angular_velocity.x(),
+        data.angular_velocity.y(),
+        data.angular_velocity.z(),
+        data.linear_acceleration.x(),
+        data.linear_acceleration.y(),
+        data.linear_acceleration.z(),
+    };
+}
+
+inline GpsSensorDataRep toGpsRep(const GpsBase::Output& data)
+{
+    return {
+        data.time_stamp,
+        data.gnss.geo_point.latitude,
+        data.gnss.geo_point.longitude,
+        data.gnss.geo_point.altitude,
+        data.gnss.velocity.x(),
+        data.gnss.velocity.y(),
+        data.gnss.velocity.z(),
+        data.gnss.eph,
+        data.gnss.epv,
+        data.is_valid
+    };
+}
+
+inline MagnetometerSensorDataRep toMagnetometerRep(const MagnetometerBase::Output& data)
+{
+    return {
+        data.time_stamp,
+        data.magnetic_field_body.x(),
+        data.magnetic_field_body.y(),
+        data.magnetic_field_body.z()
+    };
+}
+
+/// <summary>
+/// Перенос ответа AirSim в кадр, данные изображения перемещаются без копирования
+/// </summary>
+inline CameraFrame toCameraFrame(const DroneCamera camera, const std::uint64_t sequence, ImageResponse&& response)
+{
+    CameraFrame frame;
+    frame.camera = camera;
+    frame.sequence = sequence;
+    frame.time_stamp = response.time_stamp;
+    frame.width = static_cast<std::uint32_t>(response.width);
+    frame.height = static_cast<std::uint32_t>(response.height);
+    frame.encoding = response.compress ? ImageEncoding::Png : ImageEncoding::Bgr8;
+    frame.position[0] = response.camera_position.x();
+    frame.position[1] = response.camera_position.y();
+    frame.position[2] = response.camera_position.z();
+    frame.orientation[0] = response.camera_orientation.w();
+    frame.orientation[1] = response.camera_orientation.x();
+    frame.orientation[2] = response.camera_orientation.y();
+    frame.orientation[3] = response.camera_orientation.z();
+    frame.bytes = std::move(response.image_data_uint8);
+    return frame;
+}
+
+/// <summary>
+/// AirSim клиент
+/// </summary>
+class DroneAirSimClient : public DroneBackend
 {
 private:
     MultirotorRpcLibClient _client;
+    std::string _vehicle_name; // имя дрона в settings.json, пустое - дрон по умолчанию
+    std::mutex _rpc_mtx; // rpclib клиент не потокобезопасен
+    float _box_z = 0.0f; // высота облёта квадрата
 
 public:
     bool _yaw_is_rate = false;
-    float _yaw_or_rate = 0.0f; //  
-    float _speed = 5.0f; //     
-    DrivetrainType _drivetrain = DrivetrainType::ForwardOnly; //  
+    float _yaw_or_rate = 0.0f; // угол рысканья
+    float _speed = 5.0f; // скорость    
+    DrivetrainType _drivetrain = DrivetrainType::ForwardOnly; // наклоном вперёд
 
 public:
     /// <summary>
-    ///   
+    /// Создание клиента, каждый клиент открывает своё rpc соединение
+    /// </summary>
+    /// <param name="ip_address">Адрес симулятора</param>
+    /// <param name="port">Порт rpc сервера симулятора</param>
+    /// <param name="vehicle_name">Имя дрона, которым управляет клиент</param>
+    explicit DroneAirSimClient(const std::string& ip_address = "localhost",
+                               const std::uint16_t port = AIRSIM_RPC_PORT,
+                               const std::string& vehicle_name = "")
+        : _client(ip_address, port),
+          _vehicle_name(vehicle_name)
+    {
+    }
+
+    /// <summary>
+    /// Имя дрона в симуляторе
+    /// </summary>
+    const std::string& vehicleName() const override
+    {
+        return _vehicle_name;
+    }
+
+    /// <summary>
+    /// Список дронов, заданных в settings.json симулятора
+    /// </summary>
+    std::vector<std::string> listVehicles() override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.listVehicles();
+    }
+
+    /// <summary>
+    /// Соединение с симулятором
     /// </summary>
-    void connection()
+    void connection() override
     {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
         _client.confirmConnection();
-        _client.enableApiControl(true);
+        _client.enableApiControl(true, _vehicle_name);
+    }
+
+    /// <summary>
+    /// Включение/выключение дрона
+    /// </summary>
+    void armDisarm(bool arm = true) override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
+        _client.armDisarm(arm, _vehicle_name);
     }
 
     /// <summary>
-    /// / 
+    /// Установка параметров движения из запроса
     /// </summary>
-    void armDisarm(bool arm = true)
+    void setParams(const DroneMethodReq& request) override
     {
-        _client.enableApiControl(true);
-        _client.armDisarm(arm);
+        _speed = request.speed;
+        _drivetrain = static_cast<DrivetrainType>(request.drivetrain);
+        _yaw_is_rate = request.yaw_is_rate;
+        _yaw_or_rate = request.yaw_or_rate;
     }
 
     /// <summary>
-    /// 
+    /// Взлёт, без ожидания завершения
     /// </summary>
-    void takeoff(const float takeoff_timeout = 5)
+    /// <returns>Время выполнения манёвра, сек</returns>
+    double takeoff(const float takeoff_timeout = 5) override
     {
-        _client.enableApiControl(true);
-        _client.takeoffAsync(takeoff_timeout)->waitOnLastTask();
-        // switch to explicit hover mode so that this is the fall back when
-        // move* commands are finished.
-        std::this_thread::sleep_for(std::chrono::duration<double>(5));
-        _client.hoverAsync()->waitOnLastTask();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
+        _client.takeoffAsync(takeoff_timeout, _vehicle_name);
+        return takeoff_timeout;
     }
 
     /// <summary>
-    /// 
+    /// Посадка, без ожидания завершения
     /// </summary>
-    void landing()
+    void landing() override
     {
-        _client.enableApiControl(true);
-        _client.landAsync()->waitOnLastTask();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
+        _client.landAsync(LANDING_TIMEOUT, _vehicle_name);
     }
 
     /// <summary>
-    ///   
+    /// Включение программного управления дроном
     /// </summary>
-    BarometerBase::Output barometerData()
+    void enableApiControl() override
     {
-        return _client.getBarometerData();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
     }
 
     /// <summary>
-    ///   
+    /// Полёт с заданной скоростью в связанной с дроном системе координат.
+    /// Вызывается с постоянной частотой, каждый вызов заменяет предыдущий,
+    /// поэтому продолжительность берётся немного больше периода обновления.
     /// </summary>
-    ImuBase::Output imuData()
+    /// <param name="yaw_rate">Скорость рысканья, град/с</param>
+    /// <param name="duration">Время действия уставки, сек</param>
+    void velocityBodyFrame(const float vx, const float vy, const float vz, const float yaw_rate, const float duration) override
     {
-        return _client.getImuData();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.moveByVelocityBodyFrameAsync(vx, vy, vz, duration, DrivetrainType::MaxDegreeOfFreedom,
+                                             YawMode(true, yaw_rate), _vehicle_name);
     }
 
     /// <summary>
-    ///   GPS
+    /// Текущее положение дрона (NED)
     /// </summary>
-    GpsBase::Output gpsData()
+    Vector3r position() override
     {
-        return _client.getGpsData();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.getMultirotorState(_vehicle_name).getPosition();
     }
 
     /// <summary>
-    ///   
+    /// Дрон стоит на земле
     /// </summary>
-    MagnetometerBase::Output magnetometerData()
+    bool landed() override
     {
-        return _client.getMagnetometerData();
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.getMultirotorState(_vehicle_name).landed_state == LandedState::Landed;
     }
 
     /// <summary>
-    ///    
+    /// Полёт в точку, без ожидания завершения
     /// </summary>
-    const std::vector<ImageResponse> cameraImage(const std::string& camera_name_val)
+    void moveToPosition(const Vector3r& target, const float velocity, const DrivetrainType drivetrain, const YawMode& yaw_mode) override
     {
-        const std::vector<ImageRequest> request{ ImageRequest(camera_name_val, ImageType::Scene, false, true) };
-        const std::vector<ImageResponse> response = _client.simGetImages(request);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
+        _client.moveToPositionAsync(target.x(), target.y(), target.z(), velocity,
+                                    std::numeric_limits<float>::max(), drivetrain, yaw_mode, -1, 1, _vehicle_name);
+    }
 
-        return response;
+    /// <summary>
+    /// Переход в режим зависания, без ожидания завершения
+    /// </summary>
+    void hover() override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.hoverAsync(_vehicle_name);
     }
 
     /// <summary>
-    ///   
+    /// Отмена выполняемой в симуляторе задачи
     /// </summary>
-    const std::vector<ImageResponse> cameraPixelsDepth(const std::string& camera_name_val)
+    void cancel() override
     {
-        const std::vector<ImageRequest> request{ ImageRequest(camera_name_val, ImageType::DepthPlanar, true, false) };
-        const std::vector<ImageResponse> response = _client.simGetImages(request);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.cancelLastTask(_vehicle_name);
+    }
 
-        return response;
+    /// <summary>
+    /// Возвращает данные барометра
+    /// </summary>
+    BarometerSensorDataRep barometerData() override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return toBarometerRep(_client.getBarometerData("", _vehicle_name));
     }
 
     /// <summary>
-    ///   
+    /// Возвращает данные ИНС
     /// </summary>
-    void testFlyBox(const float speed = 3.0f, const float size = 10.0f)
+    ImuSensorDataRep imuData() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return toImuRep(_client.getImuData("", _vehicle_name));
+    }
 
-        auto position = _client.getMultirotorState().getPosition();
-        float z = position.z(); // current position (NED coordinate system).
+    /// <summary>
+    /// Возвращает данные GPS
+    /// </summary>
+    GpsSensorDataRep gpsData() override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return toGpsRep(_client.getGpsData("", _vehicle_name));
+    }
+
+    /// <summary>
+    /// Возвращает данные магнитометра
+    /// </summary>
+    MagnetometerSensorDataRep magnetometerData() override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return toMagnetometerRep(_client.getMagnetometerData("", _vehicle_name));
+    }
+
+    /// <summary>
+    /// Параметры камеры: положение и угол обзора
+    /// </summary>
+    CameraInfo cameraInfo(const std::string& camera_name) override
+    {
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.simGetCameraInfo(camera_name, _vehicle_name);
+    }
+
+    /// <summary>
+    /// Изображения нескольких камер одним запросом
+    /// </summary>
+    /// <param name="compress">true - PNG, false - несжатые пиксели BGR</param>
+    std::vector<ImageResponse> cameraImages(const std::vector<std::string>& camera_names, const bool compress = true)
+    {
+        std::vector<ImageRequest> request;
+        request.reserve(camera_names.size());
+        for (const std::string& camera_name : camera_names) {
+            request.emplace_back(camera_name, ImageType::Scene, false, compress);
+        }
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.simGetImages(request, _vehicle_name);
+    }
+
+    /// <summary>
+    /// Кадры нескольких камер одним запросом simGetImages
+    /// </summary>
+    std::vector<CameraFrame> cameraFrames(const std::vector<DroneCamera>& cameras, const bool compress = true) override
+    {
+        std::vector<std::string> camera_names;
+        camera_names.reserve(cameras.size());
+        for (const DroneCamera camera : cameras) {
+            camera_names.push_back(map_cameras.at(camera));
+        }
+
+        std::vector<ImageResponse> responses = cameraImages(camera_names, compress);
+        std::vector<CameraFrame> frames;
+        frames.reserve(responses.size());
+        for (std::size_t i = 0; i < responses.size() && i < cameras.size(); ++i) {
+            frames.push_back(toCameraFrame(cameras[i], 0, std::move(responses[i])));
+        }
+        return frames;
+    }
+
+    /// <summary>
+    /// Возвращает значение глубины
+    /// </summary>
+    std::vector<ImageResponse> cameraPixelsDepth(const std::string& camera_name_val) override
+    {
+        const std::vector<ImageRequest> request{ ImageRequest(camera_name_val, ImageType::DepthPlanar, true, false) };
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        return _client.simGetImages(request, _vehicle_name);
+    }
+
+    /// <summary>
+    /// Участок тестового проверочного полёта, без ожидания завершения
+    /// </summary>
+    /// <param name="leg">Номер участка от 0 до TEST_FLY_BOX_LEGS - 1</param>
+    /// <returns>Время выполнения участка, сек</returns>
+    double testFlyBoxLeg(const std::size_t leg, const float speed = 3.0f, const float size = 10.0f) override
+    {
+        static const float directions[TEST_FLY_BOX_LEGS][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
+
+        if (leg == 0) {
+            _box_z = _client.getMultirotorState(_vehicle_name).getPosition().z(); // current position (NED coordinate system).
+        }
         const float duration = size / speed;
         DrivetrainType drivetrain = DrivetrainType::ForwardOnly;
         YawMode yaw_mode(true, 0);
 
-        _client.moveByVelocityZAsync(speed, 0, z, duration, drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-        _client.moveByVelocityZAsync(0, speed, z, duration, drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-        _client.moveByVelocityZAsync(-speed, 0, z, duration, drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-        _client.moveByVelocityZAsync(0, -speed, z, duration, drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+        const float* direction = directions[leg % TEST_FLY_BOX_LEGS];
+        _client.moveByVelocityZAsync(speed * direction[0], speed * direction[1], _box_z, duration, drivetrain, yaw_mode, _vehicle_name);
 
-        _client.hoverAsync()->waitOnLastTask();
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт вверх
     /// </summary>
-    void toUpFly()
+    double toUpFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).        
-        const float size = 2.0f; //  
-        const float duration = size / _speed; //  
-        //   
+        const float size = 2.0f; // расстояние подъёма
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         yaw_mode.setZeroRate(); 
 
-        _client.moveByVelocityZAsync(0, 0, z - size, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(0, 0, z - size, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт вниз
     /// </summary>
-    void toDownFly()
+    double toDownFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).
-        const float size = 2.0f; //  
-        const float duration = size / _speed; //  
-        //   
+        const float size = 2.0f; // расстояние опускания
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         yaw_mode.setZeroRate();
 
-        _client.moveByVelocityZAsync(0, 0, z + size, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(0, 0, z + size, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт вперёд
     /// </summary>
-    void toForwardFly()
+    double toForwardFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).
-        const float size = 1.0f; //  
-        const float duration = size / _speed; //  
-        //   
+        const float size = 1.0f; // расстояние 
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         if (_drivetrain == DrivetrainType::ForwardOnly) {
             yaw_mode.is_rate = false;
@@ -222,24 +450,23 @@ public:
             yaw_mode.setZeroRate();
         }
 
-        _client.moveByVelocityZAsync(_speed, 0, z, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(_speed, 0, z, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт вправо
     /// </summary>
-    void toRightFly()
+    double toRightFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).
-        const float size = 1.0f; // 
-        const float duration = size / _speed; //  
-        //   
+        const float size = 1.0f; // расстояние
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         if (_drivetrain == DrivetrainType::ForwardOnly) {
             yaw_mode.is_rate = false;
@@ -249,24 +476,23 @@ public:
             yaw_mode.setZeroRate();
         }
 
-        _client.moveByVelocityZAsync(0, _speed, z, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(0, _speed, z, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт влево
     /// </summary>
-    void toLeftFly()
+    double toLeftFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).
-        const float size = 1.0f; // 
-        const float duration = size / _speed; //  
-        //   
+        const float size = 1.0f; // расстояние
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         if (_drivetrain == DrivetrainType::ForwardOnly) {
             yaw_mode.is_rate = false;
@@ -276,24 +502,23 @@ public:
             yaw_mode.setZeroRate();
         }
 
-        _client.moveByVelocityZAsync(0, -_speed, z, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(0, -_speed, z, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    ///  
+    /// Полёт назад
     /// </summary>
-    void toBackFly()
+    double toBackFly() override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
 
-        auto position = _client.getMultirotorState().getPosition();
+        auto position = _client.getMultirotorState(_vehicle_name).getPosition();
         float z = position.z(); // current position (NED coordinate system).
-        const float size = 1.0f; // 
-        const float duration = size / _speed; //  
-        //   
+        const float size = 1.0f; // расстояние
+        const float duration = size / _speed; // продолжительность манёвра
+        // Установить угол рысканья
         YawMode yaw_mode;
         if (_drivetrain == DrivetrainType::ForwardOnly) {
             yaw_mode.is_rate = false;
@@ -303,80 +528,25 @@ public:
             yaw_mode.setZeroRate();
         }
 
-        _client.moveByVelocityZAsync(-_speed, 0, z, duration, _drivetrain, yaw_mode);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
+        _client.moveByVelocityZAsync(-_speed, 0, z, duration, _drivetrain, yaw_mode, _vehicle_name);
+        return duration;
     }
 
     /// <summary>
-    /// 
+    /// Поворот
     /// </summary>
-    void rotateByYaw(bool left = true)
+    double rotateByYaw(bool left = true) override
     {
-        _client.enableApiControl(true);
+        std::lock_guard<std::mutex> lock(_rpc_mtx);
+        _client.enableApiControl(true, _vehicle_name);
         const float duration = 1.0f;
         float yaw_rate = left ? 4.0f : -4.0f;
         if (_yaw_is_rate) {
             yaw_rate = left ? _yaw_or_rate : -_yaw_or_rate;
         }
 
-        _client.rotateByYawRateAsync(yaw_rate, duration);
-        std::this_thread::sleep_for(std::chrono::duration<double>(duration));
-
-        _client.hoverAsync()->waitOnLastTask();
-    }
-
-    /// <summary>
-    ///        
-    /// </summary>
-    double calculateDistanceToObject(const std::string& camera_name_val, 
-                                     const std::pair<float, float> &object_center_pixel)
-    {
-        struct CameraIntrinsicMatrix
-        {
-            float fx; //     x
-            float fy; //     y
-            float cx; //    x
-            float cy; //    y
-        };
-
-        //   
-        MultirotorState rotor_state = _client.getMultirotorState();
-        Vector3r drone_position = rotor_state.getPosition();
-
-        //   (   )
-        float pixel_depth = 10.0; //     
-        const std::vector<ImageResponse> img_response = cameraPixelsDepth(camera_name_val);
-        for (const ImageResponse& image_info : img_response) {
-            const float *depth = reinterpret_cast<const float*>(image_info.image_data_float.data());
-            pixel_depth = *(depth + 640 * 360);
-        }
-
-        //   
-        CameraIntrinsicMatrix camera_matrix = {
-           1280, //    
-            720, //    
-            640, //    x
-            360  //    y
-        };
-
-        //
-        //  
-        float centerX = object_center_pixel.first;
-        float centerY = object_center_pixel.second;
-
-        //   
-        double Xw = (centerX - camera_matrix.cx) / camera_matrix.fx * pixel_depth + drone_position.x();
-        double Yw = (centerY - camera_matrix.cy) / camera_matrix.fy * pixel_depth + drone_position.y();
-        double Zw = pixel_depth + drone_position.z(); // ,    
-
-        //     
-        double distance = std::sqrt(std::pow(Xw - drone_position.x(), 2) +
-                                    std::pow(Yw - drone_position.y(), 2) +
-                                    std::pow(Zw - drone_position.z(), 2));
-
-        return distance;
+        _client.rotateByYawRateAsync(yaw_rate, duration, _vehicle_name);
+        return duration;
     }
 
     };
@@ -16,73 +16,193 @@ STRICT_MODE_ON
 #include <string>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <optional>
+#include <cstring>
 
 #include <compat/nanomsg/nn.h>
 #include <compat/nanomsg/reqrep.h>
 #include <compat/nanomsg/pipeline.h>
+#include <compat/nanomsg/pair.h>
+#include <compat/nanomsg/pubsub.h>
 
-#include "DroneAirSimClient.hpp"
+#include "DroneBackend.hpp"
+#include "VehicleRegistry.hpp"
 #include "DroneRpc.hpp"
-#include "SafeMessageQueue.hpp"
+#include "DroneWire.hpp"
+#include "RingMessageQueue.hpp"
+#include "PriorityMessageQueue.hpp"
+#include "NnMessage.hpp"
+#include "BufferPool.hpp"
+#include "FlightRecorder.hpp"
+#include "LatencyStats.hpp"
+#include "RequestDeadline.hpp"
+#include "AsyncLog.hpp"
 
 using namespace msr::airlib;
 
 namespace drone
 {
 
-void receiveMessages(int sock_fd, SafeMessageQueue<std::vector<std::byte>> &incoming_queue)
+/// <summary>
+/// Ёмкость очереди исходящих сообщений и каждого класса входящих
+/// </summary>
+constexpr std::size_t MSG_QUEUE_CAPACITY = 256;
+
+/// <summary>
+/// Период проверки касания земли при посадке, сек
+/// </summary>
+constexpr double LANDING_POLL_PERIOD = 0.1;
+
+/// <summary>
+/// Куда и в каком виде отвечать на запрос
+/// </summary>
+struct ReplyRoute
 {
-    while (true) {
-        char buffer[MSG_BUFFER_SIZE];
-        int bytes_received = nn_recv(sock_fd, buffer, sizeof(buffer), 0);
-        if (bytes_received >= 0) {
-            incoming_queue.push(std::vector<std::byte>(reinterpret_cast<const std::byte*>(buffer),
-                                                       reinterpret_cast<const std::byte*>(buffer + sizeof(buffer))));
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+    int sock = -1;
+    bool framed = true;            // ответ с заголовком протокола
+    bool on_completion = false;    // ответ по завершении манёвра (асинхронный канал)
+    std::uint32_t request_id = 0;
+    std::uint8_t vehicle_id = 0;
+    ServerStats::Clock::time_point received{}; // приём запроса, для статистики задержек
+};
+
+/// <summary>
+/// Сообщение клиента и сокет, в который нужно ответить
+/// </summary>
+struct IncomingMessage
+{
+    NnMessage message;
+    int sock = -1;
+    ServerStats::Clock::time_point received{};
+};
+
+/// <summary>
+/// Ответ и сокет назначения
+/// </summary>
+struct OutgoingReply
+{
+    ReplyBuffer buffer;
+    int sock = -1;
+    // Данные после тела ответа (статистика), обычно пусто
+    std::vector<std::byte> payload;
+    // Для статистики задержек
+    DroneMethods method = DroneMethods::Wait;
+    ServerStats::Clock::time_point received{};
+    ServerStats::Clock::time_point enqueued{};
+};
+
+// Команды безопасности выбираются раньше управляющих, управляющие - раньше чтения сенсоров
+using IncomingQueue = PriorityMessageQueue<IncomingMessage, COMMAND_PRIORITY_COUNT>;
+using OutgoingQueue = RingMessageQueue<OutgoingReply>;
+
+/// <summary>
+/// Класс приоритета сообщения по команде в заголовке запроса,
+/// повреждённое сообщение отклоняется позже и идёт младшим классом
+/// </summary>
+CommandPriority messagePriority(const NnMessage& message)
+{
+    const std::optional<WireMessage<DroneMethodReqView>> request =
+        decodeWire<DroneMethodReqView>(message.data(), message.size(), WireKind::Request);
+    if (!request || !request->body.has_method()) {
+        return CommandPriority::Informational;
     }
+    return commandPriority(request->body.method());
 }
 
-void sendResponses(int sock_fd, SafeMessageQueue<std::vector<std::byte>> &outgoing_queue)
+/// <summary>
+/// Отправка ответов во все сокеты одним потоком. Отправка без ожидания:
+/// клиент, который перестал читать ответы, не задерживает ответы другим
+/// клиентам, его ответы отбрасываются и учитываются этапом ReplyDropped.
+/// </summary>
+void sendResponses(OutgoingQueue &outgoing_queue, ServerStats &stats)
 {
-    while (true) {
-        std::vector<std::byte> response = outgoing_queue.pop();
-        if (nn_send(sock_fd, reinterpret_cast<char*>(response.data()), response.size(), 0) < 0) { 
-            std::cerr << " : " << nn_strerror(nn_errno()) << "\n";
+    while (std::optional<OutgoingReply> response = outgoing_queue.pop()) {
+        int sent = -1;
+        if (response->payload.empty()) {
+            sent = nn_send(response->sock, response->buffer.data(), response->buffer.length(), NN_DONTWAIT);
+        }
+        else {
+            // Ответ с данными не помещается в буфер пула и собирается в сообщении nanomsg
+            const std::size_t size = response->buffer.length() + response->payload.size();
+            void* msg = nn_allocmsg(size, 0);
+            if (msg != nullptr) {
+                std::memcpy(msg, response->buffer.data(), response->buffer.length());
+                std::memcpy(static_cast<char*>(msg) + response->buffer.length(), response->payload.data(), response->payload.size());
+                sent = nn_send(response->sock, &msg, NN_MSG, NN_DONTWAIT);
+                if (sent < 0) {
+                    nn_freemsg(msg);
+                }
+            }
+        }
+
+        const ServerStats::Clock::time_point now = ServerStats::Clock::now();
+        if (sent < 0) {
+            const int error = nn_errno();
+            if (error == EAGAIN) {
+                DRONE_LOG_WARN("Ответ {} отброшен: клиент не принимает сообщения", response->method);
+                stats.recordMethod(response->method, LatencyStage::ReplyDropped, now - response->enqueued);
+            }
+            else {
+                DRONE_LOG_ERROR("Ошибка отправки: {}", nn_strerror(error));
+            }
+            continue;
+        }
+
+        stats.recordMethod(response->method, LatencyStage::ReplyWait, now - response->enqueued);
+        if (response->received != ServerStats::Clock::time_point{}) {
+            stats.recordMethod(response->method, LatencyStage::Total, now - response->received);
         }
+        // Буфер возвращается в пул при выходе из области видимости
     }
 }
 
 class DroneApplication 
 {
 private:
-    DroneAirSimClient _client;
-    SafeMessageQueue<std::vector<std::byte>> _incoming_queue;
-    SafeMessageQueue<std::vector<std::byte>> _outgoing_queue;
-    std::vector<std::byte> _response;
+    // Журнал объявлен до дронов, чтобы пережить их потоки
+    std::unique_ptr<FlightRecorder> _recorder;
+    // Статистика объявлена до дронов по той же причине
+    ServerStats _stats;
+    VehicleRegistry _vehicles;
+    // Пул объявлен до очередей, чтобы пережить буферы в них
+    ReplyBufferPool _reply_pool{ MSG_QUEUE_CAPACITY + 2 };
+    IncomingQueue _incoming_queue{ MSG_QUEUE_CAPACITY };
+    OutgoingQueue _outgoing_queue{ MSG_QUEUE_CAPACITY };
+    // Возраст запросов по часам клиентов, только в цикле сообщений
+    RequestAgeEstimator _request_ages;
     int _server_sock = -1;
+    int _async_sock = -1;
     int _client_sock = -1;
-    std::atomic<bool> _get_image{ false };
-    std::atomic<bool> _running{ true };
-    std::string _camera_name_val = "front-center";
+    int _telemetry_sock = -1;
 
 public:
     /// <summary>
-    ///   rpc  nanomsg
+    /// Создание приложения
     /// </summary>
-    /// <param name="endpoint">   </param>
-    /// <return>  </return>
+    /// <param name="settings">Дроны и настройки захвата изображений</param>
+    explicit DroneApplication(const VehicleRegistrySettings& settings = VehicleRegistrySettings())
+        : _vehicles(settings)
+    {
+        _vehicles.forEach([this](DroneVehicle& vehicle) { vehicle.setStats(&_stats); });
+    }
+
+    /// <summary>
+    /// Инициализация сервера rpc на nanomsg
+    /// </summary>
+    /// <param name="endpoint">Адрес для подключения клиентов</param>
+    /// <return>Результат биндинга сокета</return>
     int initRpcControllServer(const std::string& endpoint)
     {
-        //  nanomsg
+        // Сокет nanomsg
         _server_sock = nn_socket(AF_SP, NN_REP);
         if (_server_sock < 0) {
-            std::cerr << "  socket\n";
+            std::cerr << "Ошибка инициализации socket\n";
             return -1;
         }
 
         if (nn_bind(_server_sock, endpoint.c_str()) < 0) {
-            std::cerr << "  : " << endpoint << "\n";
+            std::cerr << "Ошибка привязки адреса: " << endpoint << "\n";
             nn_close(_server_sock);
             return -1;
         }
@@ -91,274 +211,639 @@ public:
     }
 
     /// <summary>
-    /// 
+    /// Инициализация асинхронного канала команд (сокет PAIR).
+    /// Запросы не ждут друг друга, ответ с идентификатором запроса
+    /// отправляется по завершении манёвра, поэтому ответы приходят в любом порядке.
     /// </summary>
-    void airSimParams(DroneMethodReq* request)
+    /// <param name="endpoint">Адрес для подключения клиента</param>
+    /// <return>Результат биндинга сокета</return>
+    int initAsyncControlServer(const std::string& endpoint)
     {
-        _client._speed = request->speed;
-        _client._drivetrain = static_cast<DrivetrainType>(request->drivetrain);
-        _client._yaw_is_rate = request->yaw_is_rate;
-        _client._yaw_or_rate = request->yaw_or_rate;
+        _async_sock = nn_socket(AF_SP, NN_PAIR);
+        if (_async_sock < 0) {
+            std::cerr << "Ошибка инициализации асинхронного socket\n";
+            return -1;
+        }
+
+        if (nn_bind(_async_sock, endpoint.c_str()) < 0) {
+            std::cerr << "Ошибка привязки адреса: " << endpoint << "\n";
+            nn_close(_async_sock);
+            _async_sock = -1;
+            return -1;
+        }
+
+        return 0;
     }
 
     /// <summary>
-    ///   
+    /// Включение журнала полёта: команды, ответы, телеметрия и кадры всех дронов
     /// </summary>
-    void airSimApi(const DroneMethods& method)
+    /// <param name="path">Файл журнала, создаётся заново</param>
+    /// <return>Результат создания файла</return>
+    int initFlightRecorder(const std::string& path, const FlightRecorderSettings& settings = FlightRecorderSettings())
     {
-        try {
-            switch (method) {
-            case DroneMethods::Connection: {
-                _client.connection();
-                makeResponseControl(DroneMethods::Connection);
-                break;
-            }
-            case DroneMethods::Takeoff: {
-                _client.takeoff();
-                makeResponseControl(DroneMethods::Takeoff);
-                break;
-            }
-            case DroneMethods::TestFlyBox: {
-                _client.testFlyBox();
-                makeResponseControl(DroneMethods::TestFlyBox);
-                break;
-            }
-            case DroneMethods::Landing: {
-                _client.landing();
-                makeResponseControl(DroneMethods::Landing);
-                break;
-            }
-            case DroneMethods::Arm: {
-                _client.armDisarm();
-                makeResponseControl(DroneMethods::Arm);
-                break;
-            }
-            case DroneMethods::Disarm: {
-                _client.armDisarm(false);
-                makeResponseControl(DroneMethods::Disarm);
-                break;
-            }
-            case DroneMethods::ToUp: {
-                _client.toUpFly();
-                makeResponseControl(DroneMethods::ToUp);
-                break;
-            }
-            case DroneMethods::ToDown: {
-                _client.toDownFly();
-                makeResponseControl(DroneMethods::ToDown);
-                break;
-            }
-            case DroneMethods::ToForward: {
-                _client.toForwardFly();
-                makeResponseControl(DroneMethods::ToForward);
-                break;
-            }
-            case DroneMethods::ToRight: {
-                _client.toRightFly();
-                makeResponseControl(DroneMethods::ToRight);
-                break;
-            }
-            case DroneMethods::ToLeft: {
-                _client.toLeftFly();
-                makeResponseControl(DroneMethods::ToLeft);
-                break;
+        auto recorder = std::make_unique<FlightRecorder>(settings);
+        if (!recorder->open(path)) {
+            return -1;
+        }
+        _recorder = std::move(recorder);
+        _vehicles.forEach([this](DroneVehicle& vehicle) { vehicle.setRecorder(_recorder.get()); });
+        return 0;
+    }
+
+    /// <summary>
+    /// Запуск публикации телеметрии всех дронов в один сокет PUB
+    /// </summary>
+    /// <param name="endpoint">Адрес для подписки клиентов</param>
+    /// <param name="rates">Частоты опроса сенсоров</param>
+    /// <return>Результат биндинга сокета</return>
+    int initTelemetryServer(const std::string& endpoint, const TelemetryRates& rates = TelemetryRates())
+    {
+        _telemetry_sock = nn_socket(AF_SP, NN_PUB);
+        if (_telemetry_sock < 0) {
+            std::cerr << "Ошибка инициализации сокета телеметрии\n";
+            return -1;
+        }
+        if (nn_bind(_telemetry_sock, endpoint.c_str()) < 0) {
+            std::cerr << "Ошибка привязки адреса телеметрии: " << endpoint << "\n";
+            nn_close(_telemetry_sock);
+            _telemetry_sock = -1;
+            return -1;
+        }
+
+        _vehicles.forEach([this, &rates](DroneVehicle& vehicle) { vehicle.telemetry.start(_telemetry_sock, rates); });
+        return 0;
+    }
+
+    /// <summary>
+    /// Постановка команды на выполнение и формирование ответа
+    /// </summary>
+    /// <param name="request">Запрос, читается из буфера сообщения</param>
+    /// <param name="route">Куда и когда отвечать</param>
+    /// <param name="vehicle">Дрон, которому адресована команда</param>
+    void airSimApi(const DroneMethodReqView& request, const ReplyRoute& route, DroneVehicle& vehicle)
+    {
+        const DroneMethods method = request.method();
+        // Положение цели передаётся регулятору сопровождения, уставки выдаёт он сам
+        if (method == DroneMethods::VisualServoTarget) {
+            vehicle.servo.observe(request.target_x(), request.target_y());
+            reply(method, route, ReplyStatus::Accepted);
+            return;
+        }
+
+        // Уставка скорости не ставится в очередь манёвров и подтверждается сразу
+        if (method == DroneMethods::VelocitySetpoint) {
+            VelocitySetpoint setpoint;
+            setpoint.vx = request.velocity_x();
+            setpoint.vy = request.velocity_y();
+            setpoint.vz = request.velocity_z();
+            setpoint.yaw_rate = request.yaw_or_rate();
+            const bool accepted = vehicle.executor.setpoint(setpoint);
+            reply(method, route, accepted ? ReplyStatus::Accepted : ReplyStatus::Rejected);
+            return;
+        }
+
+        // Чтение сенсоров не занимает исполнитель: ответ содержит последние
+        // значения из потока телеметрии
+        if (commandPriority(method) == CommandPriority::Informational) {
+            reply(method, route, ReplyStatus::Completed);
+            return;
+        }
+
+        DroneBackend& client = vehicle.client;
+        Maneuver maneuver;
+        maneuver.method = method;
+        maneuver.priority = commandPriority(method);
+        // Параметры применяются в потоке исполнителя перед первым шагом,
+        // поэтому запрос копируется из буфера сообщения
+        maneuver.steps.push_back([&client, params = request.value()]() { client.setParams(params); return 0.0; });
+
+        switch (method) {
+        case DroneMethods::Connection: {
+            maneuver.steps.push_back([&client]() { client.connection(); return 0.0; });
+            maneuver.hover_after = false;
+            break;
+        }
+        case DroneMethods::Takeoff: {
+            maneuver.steps.push_back([&client]() { return client.takeoff(); });
+            break;
+        }
+        case DroneMethods::TestFlyBox: {
+            for (std::size_t leg = 0; leg < TEST_FLY_BOX_LEGS; ++leg) {
+                maneuver.steps.push_back([&client, leg]() { return client.testFlyBoxLeg(leg); });
             }
-            case DroneMethods::ToBack: {
-                _client.toBackFly();
-                makeResponseControl(DroneMethods::ToBack);
-                break;
+            break;
+        }
+        case DroneMethods::Landing: {
+            maneuver.steps.push_back([&client]() { client.landing(); return 0.0; });
+            // Манёвр длится до касания земли, чтобы команды управления
+            // отклонялись, пока дрон садится
+            maneuver.task = [&client](const ManeuverHold& hold) {
+                const auto deadline = std::chrono::steady_clock::now()
+                                      + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                          std::chrono::duration<float>(LANDING_TIMEOUT));
+                while (!client.landed()) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        DRONE_LOG_WARN("Посадка не завершена за {} сек", LANDING_TIMEOUT);
+                        break;
+                    }
+                    if (!hold(LANDING_POLL_PERIOD)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            maneuver.hover_after = false;
+            break;
+        }
+        case DroneMethods::Arm: {
+            maneuver.steps.push_back([&client]() { client.armDisarm(); return 0.0; });
+            maneuver.hover_after = false;
+            break;
+        }
+        case DroneMethods::Disarm: {
+            maneuver.steps.push_back([&client]() { client.armDisarm(false); return 0.0; });
+            maneuver.hover_after = false;
+            break;
+        }
+        case DroneMethods::ToUp: {
+            maneuver.steps.push_back([&client]() { return client.toUpFly(); });
+            break;
+        }
+        case DroneMethods::ToDown: {
+            maneuver.steps.push_back([&client]() { return client.toDownFly(); });
+            break;
+        }
+        case DroneMethods::ToForward: {
+            maneuver.steps.push_back([&client]() { return client.toForwardFly(); });
+            break;
+        }
+        case DroneMethods::ToRight: {
+            maneuver.steps.push_back([&client]() { return client.toRightFly(); });
+            break;
+        }
+        case DroneMethods::ToLeft: {
+            maneuver.steps.push_back([&client]() { return client.toLeftFly(); });
+            break;
+        }
+        case DroneMethods::ToBack: {
+            maneuver.steps.push_back([&client]() { return client.toBackFly(); });
+            break;
+        }
+        case DroneMethods::RotateLeft: {
+            maneuver.steps.push_back([&client]() { return client.rotateByYaw(); });
+            break;
+        }
+        case DroneMethods::RotateRight: {
+            maneuver.steps.push_back([&client]() { return client.rotateByYaw(false); });
+            break;
+        }
+        case DroneMethods::VisualServoStop: {
+            // Без шагов: манёвр только вытесняет сопровождение и переводит в зависание
+            break;
+        }
+        default:
+            // Асинхронный клиент ждёт ответ на каждый идентификатор
+            if (route.on_completion) {
+                reply(method, route, ReplyStatus::Rejected);
             }
-            case DroneMethods::RotateLeft: {
-                _client.rotateByYaw();
-                makeResponseControl(DroneMethods::RotateLeft);
-                break;
+            return;
+        }
+
+        submit(std::move(maneuver), route, vehicle);
+    }
+
+    /// <summary>
+    /// Команды миссии: загрузка маршрута, пауза, продолжение и прерывание
+    /// </summary>
+    /// <param name="message">Запрос, маршрут передаётся в данных после тела</param>
+    /// <param name="route">Куда и когда отвечать</param>
+    /// <param name="vehicle">Дрон, которому адресована команда</param>
+    void missionApi(const WireMessage<DroneMethodReqView>& message, const ReplyRoute& route, DroneVehicle& vehicle)
+    {
+        const DroneMethods method = message.body.method();
+        bool accepted = false;
+        switch (method) {
+        case DroneMethods::MissionUpload: {
+            // Идентификатор запроса становится идентификатором миссии
+            std::optional<Maneuver> maneuver = vehicle.mission.plan(route.request_id, message.payload, message.payload_size);
+            if (maneuver) {
+                DRONE_LOG_INFO("Миссия {}, точек: {}", route.request_id, message.payload_size / sizeof(MissionWaypoint));
+                submit(std::move(*maneuver), route, vehicle);
+                return;
             }
-            case DroneMethods::RotateRight: {
-                _client.rotateByYaw(false);
-                makeResponseControl(DroneMethods::RotateRight);
-                break;
+            break;
+        }
+        case DroneMethods::MissionPause:
+            accepted = vehicle.mission.pause();
+            break;
+        case DroneMethods::MissionResume:
+            accepted = vehicle.mission.resume();
+            break;
+        case DroneMethods::MissionAbort:
+            accepted = vehicle.mission.abort();
+            break;
+        default:
+            break;
+        }
+        reply(method, route, accepted ? ReplyStatus::Accepted : ReplyStatus::Rejected);
+    }
+
+    /// <summary>
+    /// Ответ на запрос статистики: p50/p99/max задержек по командам и камерам
+    /// в данных после тела ответа. Старые клиенты без заголовка получают только ответ.
+    /// </summary>
+    void statsApi(const ReplyRoute& route)
+    {
+        std::vector<std::byte> payload;
+        if (route.framed) {
+            const std::vector<LatencyStatsRep> entries = _stats.snapshot();
+            payload.resize(entries.size() * sizeof(LatencyStatsRep));
+            if (!payload.empty()) {
+                std::memcpy(payload.data(), entries.data(), payload.size());
             }
+        }
+        reply(DroneMethods::Stats, route, ReplyStatus::Completed, std::move(payload));
+    }
+
+    /// <summary>
+    /// Запрос глубины по областям кадра. Кадр глубины запрашивается у AirSim
+    /// в потоке движка глубины дрона, ответ с оценками отправляется оттуда же.
+    /// </summary>
+    /// <param name="message">Запрос, области DepthRoiReq в данных после тела</param>
+    void depthApi(const WireMessage<DroneMethodReqView>& message, const ReplyRoute& route, DroneVehicle& vehicle)
+    {
+        const std::size_t count = message.payload_size / sizeof(DepthRoiReq);
+        if (count == 0 || count > MAX_DEPTH_ROIS || message.payload_size % sizeof(DepthRoiReq) != 0) {
+            DRONE_LOG_WARN("Неверный запрос глубины, размер данных: {}", message.payload_size);
+            reply(DroneMethods::DepthQuery, route, ReplyStatus::Rejected);
+            return;
+        }
+
+        DepthJob job;
+        job.camera = message.body.camera();
+        job.rois.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            DepthRoiReq roi;
+            std::memcpy(&roi, message.payload + i * sizeof(DepthRoiReq), sizeof(roi));
+            job.rois.push_back({ roi.x, roi.y, roi.half_size, true });
+            // Способ оценки один на запрос, берётся из первой области
+            if (i == 0) {
+                job.estimator = roi.estimator;
             }
         }
-        catch (rpc::rpc_error& e) {
-            const auto msg = e.get_error().as<std::string>();
-            std::cout << "Exception raised by the API, something went wrong." << std::endl
-                      << msg << std::endl;
+        job.on_complete = [this, route](std::vector<DepthSample>&& samples) {
+            std::vector<std::byte> payload(samples.size() * sizeof(DepthSampleRep));
+            for (std::size_t i = 0; i < samples.size(); ++i) {
+                DepthSampleRep rep;
+                rep.valid = samples[i].valid;
+                rep.depth = samples[i].depth;
+                rep.distance = samples[i].distance;
+                rep.x = samples[i].x;
+                rep.y = samples[i].y;
+                rep.z = samples[i].z;
+                rep.pixels = static_cast<std::uint32_t>(samples[i].pixels);
+                std::memcpy(payload.data() + i * sizeof(rep), &rep, sizeof(rep));
+            }
+            reply(DroneMethods::DepthQuery, route, ReplyStatus::Completed, std::move(payload));
+        };
+        if (!vehicle.depth.submit(std::move(job))) {
+            DRONE_LOG_WARN("Очередь запросов глубины дрона {} заполнена", route.vehicle_id);
+            reply(DroneMethods::DepthQuery, route, ReplyStatus::Rejected);
         }
     }
 
     /// <summary>
-    ///    
+    /// Запуск захвата и отправки изображений с камер
     /// </summary>
-    void cameraImageLoop()
+    /// <param name="endpoint">Адрес приёмника изображений</param>
+    /// <return>Результат соединения сокета</return>
+    int initCameraServer(const std::string& endpoint)
     {
         _client_sock = nn_socket(AF_SP, NN_PUSH);
         if (_client_sock < 0) {
-            std::cerr << "       \n";
-            return;
+            std::cerr << "Ошибка инициализации сокета для отправки данных с камеры\n";
+            return -1;
         }
-        const char* endpoint = "tcp://127.0.0.1:20002";
-        if (nn_connect(_client_sock, endpoint) < 0) {
-            std::cerr << "       \n";
+        if (nn_connect(_client_sock, endpoint.c_str()) < 0) {
+            std::cerr << "Ошибка соединения к серверу для отправки данных с камеры\n";
             nn_close(_client_sock);
-            return;
+            _client_sock = -1;
+            return -1;
         }
 
-        std::cout << " ... " << '\n';
-        using namespace std::chrono_literals;
-        //  
-        //const float delay = (1.0f / 15.0f) * 1000.0f; // 15 fps (/) 
-        while (_running) {
-            try {
-                if (_get_image) {
-                    //std::cout << "   ... " << '\n';
-                    const std::vector<ImageResponse> img_response = _client.cameraImage(_camera_name_val);
-                    for (const ImageResponse& image_info : img_response) {
-                        int send_result = nn_send(_client_sock,
-                                                  reinterpret_cast<const char*>(image_info.image_data_uint8.data()),
-                                                  image_info.image_data_uint8.size(),
-                                                  0);
-                        //std::cout << "  , : " << image_info.image_data_uint8.size() << '\n';
-                        if (send_result < 0) {
-                            std::cerr << "      \n";
-                        }                        
-                    }
-                    //std::this_thread::sleep_for(std::chrono::duration<double>(delay));
-                    std::this_thread::sleep_for(15ms);
-
-                    // VAS: test to files
-                    //for (const ImageResponse& image_info : img_response) {
-                    //    std::string path = "D:\\Documents\\AirSim\\Recordings";
-                    //    std::string file_path = FileSystem::combine(path, std::to_string(image_info.time_stamp));
-                    //    std::ofstream file(file_path + ".png", std::ios::binary);
-                    //    file.write(reinterpret_cast<const char*>(image_info.image_data_uint8.data()), image_info.image_data_uint8.size());
-                    //    file.close();
-                    //}
-                }
-                else {
-                    std::this_thread::sleep_for(1s);
-                    //std::cout << "   ... " << '\n';
-                }
-            }
-            catch (...) {
-                std::cerr << "      \n";
-            }
-        }
+        // Кадры всех дронов идут в один сокет, дрон указан в заголовке кадра
+        _vehicles.forEach([this](DroneVehicle& vehicle) { vehicle.capture.start(_client_sock); });
+        std::cout << "Камеры готова... " << '\n';
+        return 0;
     }
 
     /// <summary>
-    ///   
+    /// Запуск цикла сообщений
     /// </summary>
     int run()
     {
-        std::thread receiver_thread(receiveMessages, _server_sock, std::ref(_incoming_queue));
-        std::thread sender_thread(sendResponses, _server_sock, std::ref(_outgoing_queue));
-        std::thread cam_image_thread(&DroneApplication::cameraImageLoop, this);
+        std::thread receiver_thread(&DroneApplication::receiveMessages, this, _server_sock);
+        std::thread async_receiver_thread;
+        if (_async_sock >= 0) {
+            async_receiver_thread = std::thread(&DroneApplication::receiveMessages, this, _async_sock);
+        }
+        std::thread sender_thread(sendResponses, std::ref(_outgoing_queue), std::ref(_stats));
 
         try {
-            while (true) {
-                //    
-                std::vector<std::byte> incoming_message = _incoming_queue.pop();
-                std::cout << " , : " << incoming_message.size() << '\n';
-
-                _response.clear();
-                DroneMethodReq *request = reinterpret_cast<DroneMethodReq*>(incoming_message.data());
-                if (request != nullptr) {
-                    _get_image = request->get_camera_image;
-                    if (_get_image) {
-                        _camera_name_val = map_cameras[request->camera];
-                        std::cout << "  !!!" << '\n';
-                    }
-                    else {
-                        std::cout << " " << '\n';
-                    }
-                    airSimParams(request);
-                    airSimApi(request->method);
-                } else {
+            // Ожидание сообщения от клиента
+            while (std::optional<IncomingMessage> incoming_message = _incoming_queue.pop()) {
+                const ServerStats::Clock::time_point dequeued = ServerStats::Clock::now();
+                const NnMessage& raw = incoming_message->message;
+                DRONE_LOG_DEBUG("Получено сообщение, размер: {}", raw.size());
+
+                // Разбор на месте, поля читаются из буфера nanomsg без копирования
+                const std::optional<WireMessage<DroneMethodReqView>> message =
+                    decodeWire<DroneMethodReqView>(raw.data(), raw.size(), WireKind::Request);
+                if (!message || !message->body.has_method()) {
+                    DRONE_LOG_WARN("Неверный формат сообщения");
+                    continue;
+                }
+
+                const DroneMethodReqView& request = message->body;
+                const ReplyRoute route = makeRoute(*incoming_message, *message);
+                _stats.recordMethod(request.method(), LatencyStage::QueueWait, dequeued - route.received);
+                if (_recorder) {
+                    _recorder->record(FlightRecordKind::Command, route.vehicle_id, raw.data(), raw.size());
+                }
+
+                // Статистика общая для сервера и не затрагивает дрон
+                if (request.method() == DroneMethods::Stats) {
+                    statsApi(route);
+                    _stats.recordMethod(DroneMethods::Stats, LatencyStage::Dispatch, ServerStats::Clock::now() - dequeued);
                     continue;
                 }
-                
-                if (_response.empty()) {
-                    std::cerr << " ...\n";
+
+                DroneVehicle* vehicle = _vehicles.find(route.vehicle_id);
+                if (vehicle == nullptr) {
+                    DRONE_LOG_WARN("Неизвестный дрон: {}", route.vehicle_id);
+                    reply(request.method(), route, ReplyStatus::Rejected);
                     continue;
                 }
-                // 
-                std::cout << ", : " << _response.size() << std::endl;
-                _outgoing_queue.push(std::move(_response)); 
+
+                if (expired(request, route, dequeued)) {
+                    reply(request.method(), route, ReplyStatus::Expired);
+                    continue;
+                }
+
+                // Запрос глубины не меняет режим дрона: сопровождение цели продолжается
+                if (request.method() == DroneMethods::DepthQuery) {
+                    depthApi(*message, route, *vehicle);
+                    _stats.recordMethod(DroneMethods::DepthQuery, LatencyStage::Dispatch, ServerStats::Clock::now() - dequeued);
+                    continue;
+                }
+
+                // Старые клиенты не передают кодирование, тогда остаётся настроенное
+                if (request.has_image_encoding()) {
+                    vehicle->capture.setEncoding(request.image_encoding());
+                }
+                vehicle->capture.setStreaming(request.get_camera_image(), request.camera());
+                DRONE_LOG_DEBUG("Камера {}", request.get_camera_image() ? "включена" : "выключена");
+
+                // Любая команда, кроме положения цели, отключает сопровождение
+                if (request.method() != DroneMethods::VisualServoTarget) {
+                    vehicle->servo.disengage();
+                }
+
+                switch (request.method()) {
+                case DroneMethods::MissionUpload:
+                case DroneMethods::MissionPause:
+                case DroneMethods::MissionResume:
+                case DroneMethods::MissionAbort:
+                    missionApi(*message, route, *vehicle);
+                    break;
+                default:
+                    airSimApi(request, route, *vehicle);
+                    break;
+                }
+                _stats.recordMethod(request.method(), LatencyStage::Dispatch, ServerStats::Clock::now() - dequeued);
             }
         }
         catch (...) {
-            std::cerr << "-   ...\n";
+            std::cerr << "Что-то пошло не так...\n";
+        }
+
+        _vehicles.stop();
+        _incoming_queue.close();
+        _outgoing_queue.close();
+        nn_shutdown(_server_sock, 0);
+        nn_close(_server_sock);
+        if (_async_sock >= 0) {
+            nn_shutdown(_async_sock, 0);
+            nn_close(_async_sock);
         }
 
-        _running = false;
         receiver_thread.join();
+        if (async_receiver_thread.joinable()) {
+            async_receiver_thread.join();
+        }
         sender_thread.join();
-        cam_image_thread.join();
 
-        nn_shutdown(_server_sock, 0);
-        nn_close(_server_sock);
-        nn_shutdown(_client_sock, 0);
-        nn_close(_client_sock);
+        if (_client_sock >= 0) {
+            nn_shutdown(_client_sock, 0);
+            nn_close(_client_sock);
+        }
+        if (_telemetry_sock >= 0) {
+            nn_close(_telemetry_sock);
+        }
+        if (_recorder) {
+            _recorder->close();
+        }
 
         return 0;
     }
 
 private:
     /// <summary>
-    ///      
+    /// Приём сообщений сокета и постановка в очередь по классу приоритета.
+    /// Команды безопасности ждут места в своём классе. Остальные ставятся
+    /// без ожидания и при переполнении класса сразу отклоняются, поэтому
+    /// поток приёма не останавливается на младшем классе и команда
+    /// безопасности, пришедшая следом, не задерживается.
     /// </summary>
-    void makeResponseControl(const DroneMethods method)
+    void receiveMessages(const int sock_fd)
     {
-        DroneReply* reply = new DroneReply;
-        reply->method = method;
-
-        if (method != DroneMethods::Connection) {
-            BarometerBase::Output &&barometer_data = _client.barometerData();
-            reply->barometer = {
-                barometer_data.time_stamp,
-                barometer_data.altitude,
-                barometer_data.pressure,
-                barometer_data.qnh
-            };
+        while (!_incoming_queue.closed()) {
+            std::optional<NnMessage> message = NnMessage::receive(sock_fd);
+            if (message) {
+                const ServerStats::Clock::time_point received = ServerStats::Clock::now();
+                const CommandPriority priority = messagePriority(*message);
+                const std::size_t lane = static_cast<std::size_t>(priority);
+                IncomingMessage incoming{ std::move(*message), sock_fd, received };
+                if (priority == CommandPriority::Safety) {
+                    if (!_incoming_queue.push(std::move(incoming), lane)) {
+                        break;
+                    }
+                }
+                // При неудаче сообщение остаётся в incoming
+                else if (!_incoming_queue.try_push(std::move(incoming), lane)) {
+                    if (_incoming_queue.closed()) {
+                        break;
+                    }
+                    rejectOverflow(incoming);
+                }
+            }
+            else if (nn_errno() == EBADF || nn_errno() == ETERM) {
+                break;
+            }
+        }
+    }
 
-            ImuBase::Output &&imu_data = _client.imuData();
-            reply->imu = {
-                imu_data.time_stamp,
-                imu_data.angular_velocity.x(),
-                imu_data.angular_velocity.y(),
-                imu_data.angular_velocity.z(),
-                imu_data.linear_acceleration.x(),
-                imu_data.linear_acceleration.y(),
-                imu_data.linear_acceleration.z(),
-            };
+    /// <summary>
+    /// Отказ на запрос, не поместившийся в очередь своего класса
+    /// </summary>
+    void rejectOverflow(const IncomingMessage& incoming)
+    {
+        const std::optional<WireMessage<DroneMethodReqView>> message =
+            decodeWire<DroneMethodReqView>(incoming.message.data(), incoming.message.size(), WireKind::Request);
+        if (!message || !message->body.has_method()) {
+            return;
+        }
+        const DroneMethods method = message->body.method();
+        DRONE_LOG_WARN("Команда {} отклонена: очередь входящих заполнена", method);
+        reply(method, makeRoute(incoming, *message), ReplyStatus::Rejected);
+    }
+
+    /// <summary>
+    /// Куда и в каком виде отвечать на запрос
+    /// </summary>
+    ReplyRoute makeRoute(const IncomingMessage& incoming, const WireMessage<DroneMethodReqView>& message) const
+    {
+        ReplyRoute route;
+        route.sock = incoming.sock;
+        route.framed = message.framed;
+        route.on_completion = incoming.sock == _async_sock;
+        route.request_id = message.body.request_id();
+        // Старые клиенты не передают номер дрона и управляют первым дроном
+        route.vehicle_id = message.body.vehicle_id();
+        route.received = incoming.received;
+        return route;
+    }
 
-            GpsBase::Output &&gps_data = _client.gpsData();
-            reply->gps = {
-                gps_data.time_stamp,
-                gps_data.gnss.geo_point.latitude,
-                gps_data.gnss.geo_point.longitude,
-                gps_data.gnss.geo_point.altitude,
-                gps_data.gnss.velocity.x(),
-                gps_data.gnss.velocity.y(),
-                gps_data.gnss.velocity.z(),
-                gps_data.gnss.eph,
-                gps_data.gnss.epv,
-                gps_data.is_valid
+    /// <summary>
+    /// Проверка срока действия запроса до разбора. Отбрасываются только
+    /// команды управления: команды безопасности выполняются всегда.
+    /// Выполненные и просроченные команды учитываются в статистике
+    /// этапами RequestAge и Expired.
+    /// </summary>
+    /// <param name="dequeued">Извлечение запроса из очереди</param>
+    /// <returns>true, если команду выполнять не нужно</returns>
+    bool expired(const DroneMethodReqView& request, const ReplyRoute& route, const ServerStats::Clock::time_point dequeued)
+    {
+        // Старые клиенты без срока передают в time_point секунды от эпохи
+        if (!request.has_deadline_us()) {
+            return false;
+        }
+        // Оценку часов клиента ведут только запросы, которые могут быть отброшены
+        const DroneMethods method = request.method();
+        const std::uint32_t deadline_us = request.deadline_us();
+        if (deadline_us == 0 || commandPriority(method) != CommandPriority::Control) {
+            return false;
+        }
+        const ServerStats::Clock::duration age =
+            _request_ages.age(route.sock, request.client_session(), route.vehicle_id, request.time_point(), route.received, dequeued);
+        if (age > std::chrono::microseconds(deadline_us)) {
+            _stats.recordMethod(method, LatencyStage::Expired, age);
+            DRONE_LOG_DEBUG("Команда {} #{} просрочена: возраст {} мкс, срок {} мкс",
+                            method, route.request_id, ServerStats::toMicros(age), deadline_us);
+            return true;
+        }
+        _stats.recordMethod(method, LatencyStage::RequestAge, age);
+        return false;
+    }
+
+    /// <summary>
+    /// Постановка манёвра исполнителю дрона и ответ по способу, выбранному клиентом
+    /// </summary>
+    void submit(Maneuver&& maneuver, const ReplyRoute& route, DroneVehicle& vehicle)
+    {
+        const DroneMethods method = maneuver.method;
+        if (route.on_completion) {
+            // Ответ из потока исполнителя, когда манёвр выполнен или вытеснен
+            maneuver.on_complete = [this, method, route](const ReplyStatus status) {
+                reply(method, route, status);
             };
+        }
+        // Манёвр младшего класса не прерывает выполняемый манёвр старшего
+        if (!vehicle.executor.submit(std::move(maneuver))) {
+            DRONE_LOG_INFO("Команда {} отклонена: выполняется команда старшего класса", method);
+            reply(method, route, ReplyStatus::Rejected);
+            return;
+        }
+        // REQ/REP: ответ сразу после постановки, не дожидаясь манёвра
+        if (!route.on_completion) {
+            reply(method, route, ReplyStatus::Accepted);
+        }
+    }
 
-            MagnetometerBase::Output&& magnetometer_data = _client.magnetometerData();
-            reply->magnetometer = {
-                magnetometer_data.time_stamp,
-                magnetometer_data.magnetic_field_body.x(),
-                magnetometer_data.magnetic_field_body.y(),
-                magnetometer_data.magnetic_field_body.z()
-            };  
-        }
-        
-        _response = std::vector<std::byte>(reinterpret_cast<const std::byte*>(reply),
-                                           reinterpret_cast<const std::byte*>(reply + sizeof(DroneReply)));
-        delete reply;
+    /// <summary>
+    /// Создание структуры ответа на упраляющую команду
+    /// </summary>
+    /// <param name="framed">false - ответ старого формата без заголовка</param>
+    /// <param name="request_id">Идентификатор запроса, на который дан ответ</param>
+    /// <param name="status">Состояние выполнения команды</param>
+    /// <param name="vehicle_id">Номер дрона, выполнявшего команду</param>
+    /// <param name="payload_size">Размер данных, отправляемых после тела ответа</param>
+    /// <returns>Пустой буфер, если все буферы пула ждут отправки</returns>
+    ReplyBuffer makeResponseControl(const DroneMethods method,
+                                    const bool framed,
+                                    const std::uint32_t request_id,
+                                    const ReplyStatus status,
+                                    const std::uint8_t vehicle_id,
+                                    const std::size_t payload_size = 0)
+    {
+        // Ответ собирается прямо в буфере из пула
+        ReplyBuffer buffer = _reply_pool.try_acquire();
+        if (!buffer) {
+            return buffer;
+        }
+        DroneReply* reply = encodeReply(buffer, method, framed, request_id, status, vehicle_id, payload_size);
+
+        // Последние значения сенсоров из потока телеметрии, без обращения к AirSim
+        DroneVehicle* vehicle = _vehicles.find(vehicle_id);
+        if (vehicle != nullptr && method != DroneMethods::Connection) {
+            vehicle->telemetry.latest(*reply);
+        }
+
+        return buffer;
+    }
+
+    /// <summary>
+    /// Постановка ответа в очередь отправки без ожидания: если очередь
+    /// заполнена, ответ отбрасывается, а цикл сообщений и исполнители
+    /// продолжают работу.
+    /// Вызывается из цикла сообщений и из потока исполнителя команд.
+    /// </summary>
+    /// <param name="payload">Данные после тела ответа, только для ответов с заголовком</param>
+    void reply(const DroneMethods method, const ReplyRoute& route, const ReplyStatus status, std::vector<std::byte>&& payload = {})
+    {
+        try {
+            ReplyBuffer buffer = makeResponseControl(method, route.framed, route.request_id, status, route.vehicle_id, payload.size());
+            if (!buffer) {
+                DRONE_LOG_WARN("Ответ {} отброшен: нет свободных буферов", method);
+                _stats.recordMethod(method, LatencyStage::ReplyDropped, ServerStats::Clock::duration::zero());
+                return;
+            }
+            DRONE_LOG_DEBUG("Отправка, размер: {}", buffer.length() + payload.size());
+            if (_recorder) {
+                _recorder->record(FlightRecordKind::Reply, route.vehicle_id, buffer.data(), buffer.length(), payload.data(), payload.size());
+            }
+            OutgoingReply outgoing{ std::move(buffer), route.sock, std::move(payload), method, route.received };
+            outgoing.enqueued = ServerStats::Clock::now();
+            if (!_outgoing_queue.try_push(std::move(outgoing)) && !_outgoing_queue.closed()) {
+                DRONE_LOG_WARN("Ответ {} отброшен: очередь отправки заполнена", method);
+                _stats.recordMethod(method, LatencyStage::ReplyDropped, ServerStats::Clock::duration::zero());
+            }
+        }
+        catch (rpc::rpc_error& e) {
+            const auto msg = e.get_error().as<std::string>();
+            DRONE_LOG_ERROR("Exception raised by the API, something went wrong.\n{}", msg);
+        }
     }
 };
 
@@ -0,0 +1,134 @@
+#ifndef DRONE_BACKEND_HPP
+#define DRONE_BACKEND_HPP
+
+#include "common/common_utils/StrictMode.hpp"
+STRICT_MODE_OFF
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+#include "rpc/rpc_error.h"
+STRICT_MODE_ON
+
+#include "common/CommonStructs.hpp"
+#include "common/ImageCaptureBase.hpp"
+#include "vehicles/multirotor/api/MultirotorCommon.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CameraFrame.hpp"
+#include "DroneRpc.hpp"
+
+using namespace msr::airlib;
+
+typedef ImageCaptureBase::ImageRequest ImageRequest;
+typedef ImageCaptureBase::ImageResponse ImageResponse;
+typedef ImageCaptureBase::ImageType ImageType;
+
+namespace drone
+{
+/// <summary>
+/// Число участков облёта квадрата
+/// </summary>
+constexpr std::size_t TEST_FLY_BOX_LEGS = 4;
+
+/// <summary>
+/// Наибольшее время посадки, сек
+/// </summary>
+constexpr float LANDING_TIMEOUT = 60.0f;
+
+/// <summary>
+/// Источник команд, сенсоров и изображений одного дрона: AirSim или запись полёта.
+/// Каждый объект используется из одного потока, кроме вызовов,
+/// которые реализация явно защищает.
+/// </summary>
+class DroneBackend
+{
+public:
+    virtual ~DroneBackend() = default;
+
+    /// <summary>
+    /// Имя дрона в симуляторе
+    /// </summary>
+    virtual const std::string& vehicleName() const = 0;
+
+    /// <summary>
+    /// Список дронов, доступных источнику
+    /// </summary>
+    virtual std::vector<std::string> listVehicles() = 0;
+
+    // Команды. Манёвры не ждут завершения и возвращают время выполнения, сек
+
+    virtual void connection() = 0;
+    virtual void armDisarm(bool arm = true) = 0;
+    virtual void setParams(const DroneMethodReq& request) = 0;
+    virtual double takeoff(const float takeoff_timeout = 5) = 0;
+    virtual void landing() = 0;
+    virtual void enableApiControl() = 0;
+    virtual void velocityBodyFrame(const float vx, const float vy, const float vz, const float yaw_rate, const float duration) = 0;
+    virtual Vector3r position() = 0;
+    virtual bool landed() = 0;
+    virtual void moveToPosition(const Vector3r& target, const float velocity, const DrivetrainType drivetrain, const YawMode& yaw_mode) = 0;
+    virtual void hover() = 0;
+    virtual void cancel() = 0;
+    virtual double testFlyBoxLeg(const std::size_t leg, const float speed = 3.0f, const float size = 10.0f) = 0;
+    virtual double toUpFly() = 0;
+    virtual double toDownFly() = 0;
+    virtual double toForwardFly() = 0;
+    virtual double toRightFly() = 0;
+    virtual double toLeftFly() = 0;
+    virtual double toBackFly() = 0;
+    virtual double rotateByYaw(bool left = true) = 0;
+
+    // Сенсоры в формате протокола
+
+    virtual BarometerSensorDataRep barometerData() = 0;
+    virtual ImuSensorDataRep imuData() = 0;
+    virtual GpsSensorDataRep gpsData() = 0;
+    virtual MagnetometerSensorDataRep magnetometerData() = 0;
+
+    // Изображения
+
+    /// <summary>
+    /// Кадры нескольких камер одним запросом, по кадру на камеру в том же порядке
+    /// </summary>
+    /// <param name="compress">true - PNG, false - несжатые пиксели BGR; запись отдаёт кадры как записаны</param>
+    virtual std::vector<CameraFrame> cameraFrames(const std::vector<DroneCamera>& cameras, const bool compress = true) = 0;
+    virtual CameraInfo cameraInfo(const std::string& camera_name) = 0;
+    virtual std::vector<ImageResponse> cameraPixelsDepth(const std::string& camera_name_val) = 0;
+};
+
+/// <summary>
+/// Текст исключения, перехваченного в catch (...) вокруг вызовов источника.
+/// Кроме rpc::rpc_error rpclib сообщает о потере соединения с AirSim через
+/// rpc::timeout, rpc::system_error и std::runtime_error; исключение,
+/// вышедшее из потока, завершило бы весь сервер.
+/// </summary>
+inline std::string backendErrorMessage()
+{
+    try {
+        throw;
+    }
+    catch (rpc::rpc_error& e) {
+        return e.get_error().as<std::string>();
+    }
+    catch (std::exception& e) {
+        return e.what();
+    }
+    catch (...) {
+        return "неизвестная ошибка";
+    }
+}
+
+/// <summary>
+/// Создание источника для дрона с заданным именем
+/// </summary>
+using DroneBackendFactory = std::function<std::unique_ptr<DroneBackend>(const std::string& vehicle_name)>;
+}
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef DRONE_CAMERA_CAPTURE_HPP
+#define DRONE_CAMERA_CAPTURE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <compat/nanomsg/nn.h>
+
+#include "AirSimConnectionPool.hpp"
+#include "AsyncLog.hpp"
+#include "CameraFrame.hpp"
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+#include "DroneWire.hpp"
+#include "FlightRecorder.hpp"
+#include "FrameEncoder.hpp"
+#include "LatencyStats.hpp"
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Настройки захвата изображений
+/// </summary>
+struct CameraCaptureSettings
+{
+    // Камеры, захватываемые всегда при включённой передаче, и их частота кадров
+    std::map<DroneCamera, double> cameras_fps;
+    // Частота кадров камеры, выбранной клиентом
+    double default_fps = 30.0;
+    // Число одновременно выполняемых запросов simGetImages
+    std::size_t pipeline_depth = 2;
+    // Ёмкость очереди кадров на отправку
+    std::size_t frame_queue_capacity = 16;
+    // Кодирование кадров
+    FrameEncoderSettings encoder;
+};
+
+/// <summary>
+/// Конвейерный захват изображений со всех включённых камер.
+/// Все камеры, у которых наступил срок кадра, запрашиваются одним вызовом
+/// simGetImages; несколько запросов выполняются параллельно на отдельных
+/// соединениях, темп кадров каждой камеры задаётся по сроку следующего кадра.
+/// Пакеты передаются на отправку в порядке резервирования, поэтому номера
+/// кадров каждой камеры уходят клиенту по возрастанию.
+/// </summary>
+class CameraCaptureEngine
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct CameraSchedule
+    {
+        bool enabled = false;
+        Clock::duration period{ 0 };
+        Clock::time_point deadline{};
+        std::uint64_t sequence = 0; // номер следующего кадра
+    };
+
+    struct CaptureSlot
+    {
+        DroneCamera camera;
+        std::uint64_t sequence;
+    };
+
+    struct CaptureBatch
+    {
+        std::uint64_t ticket = 0; // порядковый номер пакета
+        std::vector<CaptureSlot> slots;
+    };
+
+    AirSimConnectionPool& _airsim;
+    CameraCaptureSettings _settings;
+    std::uint8_t _vehicle_id = 0;
+    int _sock = -1;
+    std::atomic<FlightRecorder*> _recorder{ nullptr };
+    std::atomic<ServerStats*> _stats{ nullptr };
+
+    std::mutex _mtx;
+    std::condition_variable _cond_var;
+    std::array<CameraSchedule, CAMERA_COUNT> _schedule{};
+    bool _streaming = false;
+    DroneCamera _requested_camera = DroneCamera::front_center;
+    std::uint64_t _next_ticket = 0;
+    std::atomic<bool> _running{ false };
+
+    // Очерёдность передачи пакетов на отправку
+    std::mutex _publish_mtx;
+    std::condition_variable _publish_cond;
+    std::uint64_t _published_ticket = 0;
+    std::atomic<ImageEncoding> _encoding;
+
+    RingMessageQueue<CameraFrame> _frames;
+    std::vector<std::thread> _workers;
+    std::thread _sender;
+    std::atomic<std::uint64_t> _dropped_frames{ 0 };
+
+public:
+    /// <summary>
+    /// Создание захвата для одного дрона
+    /// </summary>
+    /// <param name="vehicle_id">Номер дрона, записывается в заголовок кадра</param>
+    CameraCaptureEngine(AirSimConnectionPool& airsim, const CameraCaptureSettings& settings, const std::uint8_t vehicle_id = 0)
+        : _airsim(airsim),
+          _settings(settings),
+          _vehicle_id(vehicle_id),
+          _encoding(settings.encoder.encoding),
+          _frames(settings.frame_queue_capacity)
+    {
+    }
+
+    ~CameraCaptureEngine()
+    {
+        stop();
+    }
+
+    CameraCaptureEngine(const CameraCaptureEngine&) = delete;
+    CameraCaptureEngine& operator=(const CameraCaptureEngine&) = delete;
+
+    /// <summary>
+    /// Запуск потоков захвата и отправки
+    /// </summary>
+    /// <param name="sock">Сокет для отправки кадров</param>
+    void start(int sock)
+    {
+        _sock = sock;
+        {
+            // Пакеты, брошенные при прошлой остановке, не задерживают новые
+            std::scoped_lock lock(_mtx, _publish_mtx);
+            _published_ticket = _next_ticket;
+        }
+        _running = true;
+        const std::size_t workers = std::min(_settings.pipeline_depth, _airsim.cameraConnections());
+        for (std::size_t i = 0; i < workers; ++i) {
+            _workers.emplace_back(&CameraCaptureEngine::captureLoop, this, i);
+        }
+        _sender = std::thread(&CameraCaptureEngine::sendLoop, this);
+    }
+
+    /// <summary>
+    /// Остановка потоков
+    /// </summary>
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _running = false;
+        }
+        _cond_var.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(_publish_mtx);
+        }
+        _publish_cond.notify_all();
+        for (std::thread& worker : _workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        _workers.clear();
+        _frames.close();
+        if (_sender.joinable()) {
+            _sender.join();
+        }
+    }
+
+    /// <summary>
+    /// Включение/выключение передачи и выбор камеры клиента
+    /// </summary>
+    void setStreaming(const bool enabled, const DroneCamera camera)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (enabled == _streaming && camera == _requested_camera) {
+                return;
+            }
+            _streaming = enabled;
+            _requested_camera = camera;
+            reschedule();
+        }
+        _cond_var.notify_all();
+    }
+
+    /// <summary>
+    /// Запись отправляемых кадров в журнал полёта, nullptr - без записи
+    /// </summary>
+    void setRecorder(FlightRecorder* recorder)
+    {
+        _recorder = recorder;
+    }
+
+    /// <summary>
+    /// Учёт задержек захвата и отправки кадров, nullptr - без учёта
+    /// </summary>
+    void setStats(ServerStats* stats)
+    {
+        _stats = stats;
+    }
+
+    /// <summary>
+    /// Выбор кодирования кадров, применяется со следующего запроса к AirSim
+    /// </summary>
+    void setEncoding(const ImageEncoding encoding)
+    {
+        _encoding.store(encoding, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Число кадров, отброшенных из-за переполнения очереди отправки
+    /// </summary>
+    std::uint64_t droppedFrames() const
+    {
+        return _dropped_frames.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// <summary>
+    /// Пересчёт расписания камер (вызывается под блокировкой)
+    /// </summary>
+    void reschedule()
+    {
+        const Clock::time_point now = Clock::now();
+        for (std::size_t i = 0; i < CAMERA_COUNT; ++i) {
+            const DroneCamera camera = static_cast<DroneCamera>(i);
+            double fps = 0.0;
+            if (_streaming) {
+                const auto it = _settings.cameras_fps.find(camera);
+                if (it != _settings.cameras_fps.end()) {
+                    fps = it->second;
+                }
+                else if (camera == _requested_camera) {
+                    fps = _settings.default_fps;
+                }
+            }
+
+            CameraSchedule& schedule = _schedule[i];
+            const bool was_enabled = schedule.enabled;
+            schedule.enabled = fps > 0.0;
+            if (schedule.enabled) {
+                schedule.period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+                if (!was_enabled) {
+                    schedule.deadline = now;
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Ожидание срока кадра и выбор камер для одного пакетного запроса
+    /// </summary>
+    /// <returns>Пакет без камер при остановке</returns>
+    CaptureBatch nextBatch()
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        while (_running) {
+            Clock::time_point earliest = Clock::time_point::max();
+            for (const CameraSchedule& schedule : _schedule) {
+                if (schedule.enabled && schedule.deadline < earliest) {
+                    earliest = schedule.deadline;
+                }
+            }
+
+            if (earliest == Clock::time_point::max()) {
+                _cond_var.wait(lock);
+                continue;
+            }
+            if (Clock::now() < earliest) {
+                _cond_var.wait_until(lock, earliest);
+                continue;
+            }
+
+            // Резервирование кадров: следующий срок считается от предыдущего,
+            // при отставании больше чем на период кадры пропускаются
+            const Clock::time_point now = Clock::now();
+            CaptureBatch batch;
+            batch.ticket = _next_ticket++;
+            for (std::size_t i = 0; i < CAMERA_COUNT; ++i) {
+                CameraSchedule& schedule = _schedule[i];
+                if (!schedule.enabled || schedule.deadline > now) {
+                    continue;
+                }
+                // Номер присваивается при резервировании, поэтому потерянные
+                // при отправке кадры видны клиенту как пропуск номера
+                batch.slots.push_back({ static_cast<DroneCamera>(i), schedule.sequence++ });
+                schedule.deadline += schedule.period;
+                if (schedule.deadline + schedule.period < now) {
+                    schedule.deadline = now + schedule.period;
+                }
+            }
+            return batch;
+        }
+        return {};
+    }
+
+    /// <summary>
+    /// Цикл захвата, один поток на соединение конвейера
+    /// </summary>
+    void captureLoop(const std::size_t connection)
+    {
+        DroneBackend& client = _airsim.client(AirSimRole::Camera, connection);
+        // Кодирование выполняется в потоке захвата, параллельно с запросами других потоков
+        FrameEncoder encoder(_settings.encoder);
+        while (_running) {
+            const CaptureBatch batch = nextBatch();
+            if (batch.slots.empty()) {
+                continue;
+            }
+
+            std::vector<DroneCamera> cameras;
+            cameras.reserve(batch.slots.size());
+            for (const CaptureSlot& slot : batch.slots) {
+                cameras.push_back(slot.camera);
+            }
+
+            std::vector<CameraFrame> ready;
+            try {
+                const ImageEncoding target = _encoding.load(std::memory_order_relaxed);
+                const Clock::time_point requested = Clock::now();
+                std::vector<CameraFrame> frames = client.cameraFrames(cameras, FrameEncoder::requestCompressed(target));
+                const Clock::time_point captured = Clock::now();
+                ServerStats* stats = _stats.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < frames.size() && i < batch.slots.size(); ++i) {
+                    CameraFrame& frame = frames[i];
+                    if (frame.bytes.empty()) {
+                        continue; // камера не вернула изображение или его нет в записи
+                    }
+                    frame.camera = batch.slots[i].camera;
+                    frame.sequence = batch.slots[i].sequence;
+                    frame.vehicle_id = _vehicle_id;
+                    frame.captured = captured;
+                    if (stats != nullptr) {
+                        // Пакетный запрос: каждой камере пакета учитывается его полное время
+                        stats->recordCamera(frame.camera, LatencyStage::FrameCapture, captured - requested);
+                    }
+                    frame.encoding = encoder.encode(frame.encoding, target, frame.width, frame.height, frame.bytes);
+                    ready.push_back(std::move(frame));
+                }
+            }
+            catch (...) {
+                DRONE_LOG_ERROR("Ошибка получения данных с камеры: {}", backendErrorMessage());
+            }
+            // Пакет без кадров тоже проходит очередь, иначе следующие пакеты ждали бы его
+            publish(batch.ticket, ready);
+        }
+    }
+
+    /// <summary>
+    /// Передача кадров пакета на отправку после всех ранее зарезервированных
+    /// пакетов: запросы выполняются параллельно и завершаются в любом порядке,
+    /// а клиент отбрасывает кадр с номером меньше уже полученного
+    /// </summary>
+    void publish(const std::uint64_t ticket, std::vector<CameraFrame>& frames)
+    {
+        std::unique_lock<std::mutex> lock(_publish_mtx);
+        _publish_cond.wait(lock, [this, ticket]() { return _published_ticket == ticket || !_running; });
+        if (_published_ticket != ticket) {
+            return; // остановка
+        }
+        for (CameraFrame& frame : frames) {
+            if (!_frames.try_push(std::move(frame))) {
+                _dropped_frames.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        ++_published_ticket;
+        lock.unlock();
+        _publish_cond.notify_all();
+    }
+
+    /// <summary>
+    /// Цикл отправки кадров в сокет: заголовок и изображение одним сообщением
+    /// </summary>
+    void sendLoop()
+    {
+        while (std::optional<CameraFrame> frame = _frames.pop()) {
+            const ImageFrameHeader header = toFrameHeader(*frame);
+            if (FlightRecorder* recorder = _recorder.load()) {
+                recorder->record(FlightRecordKind::Frame, _vehicle_id, &header, sizeof(header), frame->bytes.data(), frame->bytes.size());
+            }
+            void* msg = nn_allocmsg(frameSize(header), 0);
+            if (msg == nullptr) {
+                DRONE_LOG_ERROR("Ошибка выделения сообщения для кадра камеры");
+                continue;
+            }
+            encodeFrame(static_cast<std::byte*>(msg), header, frame->bytes.data());
+            if (nn_send(_sock, &msg, NN_MSG, 0) < 0) {
+                nn_freemsg(msg);
+                DRONE_LOG_ERROR("Ошибка отправки данных с камеры в сокет");
+            }
+            else if (ServerStats* stats = _stats.load(std::memory_order_relaxed)) {
+                stats->recordCamera(frame->camera, LatencyStage::FrameSend, Clock::now() - frame->captured);
+            }
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef DRONE_COMMAND_EXECUTOR_HPP
+#define DRONE_COMMAND_EXECUTOR_HPP
+
+#include "common/common_utils/StrictMode.hpp"
+STRICT_MODE_OFF
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+#include "rpc/rpc_error.h"
+STRICT_MODE_ON
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "AsyncLog.hpp"
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+#include "LatencyStats.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Класс приоритета команды. Команда старшего класса обрабатывается раньше
+/// и вытесняет манёвр младшего класса, команда младшего класса не прерывает
+/// манёвр старшего и отклоняется.
+/// </summary>
+enum class CommandPriority : std::uint8_t
+{
+    Informational = 0, // чтение сенсоров, статистика
+    Control,           // движение, взлёт, миссия, непрерывное управление
+    Safety             // посадка, выключение моторов, переход в зависание
+};
+
+/// <summary>
+/// Число классов приоритета
+/// </summary>
+constexpr std::size_t COMMAND_PRIORITY_COUNT = static_cast<std::size_t>(CommandPriority::Safety) + 1;
+
+/// <summary>
+/// Класс приоритета команды
+/// </summary>
+inline CommandPriority commandPriority(const DroneMethods method)
+{
+    switch (method) {
+    case DroneMethods::Landing:
+    case DroneMethods::Disarm:
+    case DroneMethods::MissionAbort:
+    case DroneMethods::VisualServoStop:
+        return CommandPriority::Safety;
+    case DroneMethods::Wait:
+    case DroneMethods::BarometerData:
+    case DroneMethods::ImuData:
+    case DroneMethods::GpsData:
+    case DroneMethods::MagnetometerData:
+    case DroneMethods::Stats:
+    case DroneMethods::DepthQuery:
+        return CommandPriority::Informational;
+    default:
+        return CommandPriority::Control;
+    }
+}
+
+/// <summary>
+/// Шаг манёвра: асинхронный вызов AirSim, возвращает время удержания в секундах
+/// </summary>
+using ManeuverStep = std::function<double()>;
+
+/// <summary>
+/// Ожидание внутри долгого шага манёвра
+/// </summary>
+/// <returns>false, если манёвр вытеснен или исполнитель остановлен</returns>
+using ManeuverHold = std::function<bool(double)>;
+
+/// <summary>
+/// Долгий шаг манёвра, сам решает, когда закончить (например, миссия),
+/// выполняется в потоке исполнителя после обычных шагов
+/// </summary>
+/// <returns>true, если шаг завершён штатно</returns>
+using ManeuverTask = std::function<bool(const ManeuverHold&)>;
+
+/// <summary>
+/// Уведомление о завершении манёвра, вызывается в потоке исполнителя
+/// </summary>
+using ManeuverCallback = std::function<void(ReplyStatus)>;
+
+/// <summary>
+/// Манёвр - последовательность шагов одной команды
+/// </summary>
+struct Maneuver
+{
+    DroneMethods method = DroneMethods::Wait;
+    CommandPriority priority = CommandPriority::Control;
+    std::vector<ManeuverStep> steps;
+    ManeuverTask task; // необязательный долгий шаг
+    bool hover_after = true; // зависание после штатного завершения
+    ManeuverCallback on_complete; // Completed, Preempted или Failed
+};
+
+/// <summary>
+/// Уставка скорости непрерывного управления
+/// </summary>
+struct VelocitySetpoint
+{
+    float vx = 0.0f; // вперёд, м/с
+    float vy = 0.0f; // вправо, м/с
+    float vz = 0.0f; // вниз, м/с
+    float yaw_rate = 0.0f; // град/с
+};
+
+/// <summary>
+/// Параметры непрерывного управления
+/// </summary>
+struct TeleopSettings
+{
+    // Период обновления команды скорости в AirSim
+    std::chrono::milliseconds period{ 20 };
+    // Время действия одной команды, больше периода, чтобы не было остановок между обновлениями
+    std::chrono::milliseconds horizon{ 100 };
+    // Без новых уставок дольше этого времени дрон зависает
+    std::chrono::milliseconds watchdog{ 250 };
+};
+
+/// <summary>
+/// Асинхронный исполнитель команд дрона.
+/// Команды принимаются в любой момент, новая команда того же или старшего
+/// класса вытесняет выполняемую без ожидания зависания, команда младшего
+/// класса отклоняется. Все вызовы AirSim выполняются в потоке исполнителя.
+/// В режиме непрерывного управления последняя уставка скорости передаётся
+/// в AirSim с постоянной частотой, пока уставки приходят.
+/// </summary>
+class DroneCommandExecutor
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    DroneBackend& _client;
+    TeleopSettings _teleop_settings;
+    std::mutex _mtx;
+    std::condition_variable _cond_var;
+    std::optional<Maneuver> _pending;
+    // Класс выполняемого манёвра, Informational - исполнитель свободен
+    CommandPriority _active = CommandPriority::Informational;
+    std::uint64_t _generation = 0;
+    bool _running = true;
+    std::atomic<DroneMethods> _current{ DroneMethods::Wait };
+    std::atomic<ServerStats*> _stats{ nullptr };
+    // Непрерывное управление
+    bool _teleop = false;
+    VelocitySetpoint _setpoint;
+    Clock::time_point _setpoint_time{};
+    std::thread _thread;
+
+public:
+    explicit DroneCommandExecutor(DroneBackend& client, const TeleopSettings& teleop = TeleopSettings())
+        : _client(client),
+          _teleop_settings(teleop),
+          _thread(&DroneCommandExecutor::loop, this)
+    {
+    }
+
+    ~DroneCommandExecutor()
+    {
+        stop();
+    }
+
+    DroneCommandExecutor(const DroneCommandExecutor&) = delete;
+    DroneCommandExecutor& operator=(const DroneCommandExecutor&) = delete;
+
+    /// <summary>
+    /// Постановка манёвра на выполнение, выполняемый манёвр прерывается
+    /// </summary>
+    /// <returns>false, если выполняется или ожидает манёвр старшего класса;
+    /// манёвр не принят и on_complete не вызывается</returns>
+    bool submit(Maneuver&& maneuver)
+    {
+        std::optional<Maneuver> dropped;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (maneuver.priority < busyPriority()) {
+                return false;
+            }
+            dropped = std::move(_pending);
+            _pending = std::move(maneuver);
+            _teleop = false;
+            ++_generation;
+        }
+        _cond_var.notify_all();
+        // Манёвр, не успевший начаться, тоже считается вытесненным
+        if (dropped && dropped->on_complete) {
+            dropped->on_complete(ReplyStatus::Preempted);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Новая уставка скорости. Первая уставка вытесняет выполняемый манёвр
+    /// и включает непрерывное управление, следующие только заменяют уставку.
+    /// </summary>
+    /// <returns>false, если выполняется или ожидает манёвр класса Safety</returns>
+    bool setpoint(const VelocitySetpoint& setpoint)
+    {
+        std::optional<Maneuver> dropped;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (CommandPriority::Control < busyPriority()) {
+                return false;
+            }
+            _setpoint = setpoint;
+            _setpoint_time = Clock::now();
+            if (!_teleop) {
+                dropped = std::move(_pending);
+                _pending.reset();
+                _teleop = true;
+                ++_generation;
+            }
+        }
+        _cond_var.notify_all();
+        if (dropped && dropped->on_complete) {
+            dropped->on_complete(ReplyStatus::Preempted);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Учёт времени вызовов AirSim по командам, nullptr - без учёта
+    /// </summary>
+    void setStats(ServerStats* stats)
+    {
+        _stats = stats;
+    }
+
+    /// <summary>
+    /// Команда, выполняемая в данный момент
+    /// </summary>
+    DroneMethods current() const
+    {
+        return _current.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Остановка потока исполнителя
+    /// </summary>
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _running = false;
+            ++_generation;
+        }
+        _cond_var.notify_all();
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+private:
+    /// <summary>
+    /// Старший класс выполняемого и ожидающего манёвров (вызывается под блокировкой)
+    /// </summary>
+    CommandPriority busyPriority() const
+    {
+        CommandPriority priority = _active;
+        if (_pending && _pending->priority > priority) {
+            priority = _pending->priority;
+        }
+        if (_teleop && CommandPriority::Control > priority) {
+            priority = CommandPriority::Control;
+        }
+        return priority;
+    }
+
+    /// <summary>
+    /// Есть ли команда, сменяющая прерванный манёвр
+    /// </summary>
+    bool replaced()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _running && (_pending.has_value() || _teleop);
+    }
+
+    /// <summary>
+    /// Цикл выполнения манёвров
+    /// </summary>
+    void loop()
+    {
+        while (true) {
+            Maneuver maneuver;
+            std::uint64_t generation = 0;
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _cond_var.wait(lock, [this]() { return _pending.has_value() || _teleop || !_running; });
+                if (!_running) {
+                    break;
+                }
+                if (!_pending) {
+                    lock.unlock();
+                    teleopLoop();
+                    continue;
+                }
+                maneuver = std::move(*_pending);
+                _pending.reset();
+                _active = maneuver.priority;
+                generation = _generation;
+            }
+
+            _current = maneuver.method;
+            bool completed = true;
+            bool failed = false;
+            try {
+                for (const ManeuverStep& step : maneuver.steps) {
+                    const Clock::time_point started = Clock::now();
+                    const double hold = step();
+                    if (ServerStats* stats = _stats.load(std::memory_order_relaxed)) {
+                        stats->recordMethod(maneuver.method, LatencyStage::Execution, Clock::now() - started);
+                    }
+                    if (!holdFor(hold, generation)) {
+                        completed = false;
+                        break;
+                    }
+                }
+                if (completed && maneuver.task) {
+                    completed = maneuver.task([this, generation](const double seconds) {
+                        return holdFor(seconds, generation);
+                    });
+                }
+                if (completed && maneuver.hover_after) {
+                    _client.hover();
+                }
+                else if (!completed && !replaced()) {
+                    // Манёвр прерван без следующей команды (остановка сервера):
+                    // задача AirSim отменяется, иначе дрон продолжит движение
+                    _client.cancel();
+                }
+            }
+            catch (...) {
+                DRONE_LOG_ERROR("Ошибка выполнения команды {}: {}", maneuver.method, backendErrorMessage());
+                completed = false;
+                failed = true;
+            }
+            _current = DroneMethods::Wait;
+            {
+                // Вытеснивший манёвр учитывается в _pending или _teleop
+                std::lock_guard<std::mutex> lock(_mtx);
+                _active = CommandPriority::Informational;
+            }
+            if (maneuver.on_complete) {
+                maneuver.on_complete(failed ? ReplyStatus::Failed
+                                            : completed ? ReplyStatus::Completed : ReplyStatus::Preempted);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Цикл непрерывного управления: короткие команды скорости с постоянной
+    /// частотой, зависание при потере уставок или выход по новому манёвру
+    /// </summary>
+    void teleopLoop()
+    {
+        _current = DroneMethods::VelocitySetpoint;
+        const float horizon = std::chrono::duration<float>(_teleop_settings.horizon).count();
+        bool api_enabled = false;
+        Clock::time_point next_tick = Clock::now();
+        while (true) {
+            VelocitySetpoint setpoint;
+            bool expired = false;
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                if (!_teleop || !_running) {
+                    break;
+                }
+                expired = Clock::now() - _setpoint_time > _teleop_settings.watchdog;
+                if (expired) {
+                    _teleop = false;
+                }
+                setpoint = _setpoint;
+            }
+
+            try {
+                if (expired) {
+                    DRONE_LOG_WARN("Нет уставок скорости, зависание");
+                    _client.hover();
+                    break;
+                }
+                if (!api_enabled) {
+                    _client.enableApiControl();
+                    api_enabled = true;
+                }
+                const Clock::time_point started = Clock::now();
+                _client.velocityBodyFrame(setpoint.vx, setpoint.vy, setpoint.vz, setpoint.yaw_rate, horizon);
+                if (ServerStats* stats = _stats.load(std::memory_order_relaxed)) {
+                    stats->recordMethod(DroneMethods::VelocitySetpoint, LatencyStage::Execution, Clock::now() - started);
+                }
+            }
+            catch (...) {
+                DRONE_LOG_ERROR("Ошибка непрерывного управления: {}", backendErrorMessage());
+            }
+
+            // Постоянный темп, при отставании отсчёт начинается заново
+            next_tick += _teleop_settings.period;
+            const Clock::time_point now = Clock::now();
+            if (next_tick < now) {
+                next_tick = now;
+            }
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cond_var.wait_until(lock, next_tick, [this]() { return !_teleop || !_running; });
+        }
+        _current = DroneMethods::Wait;
+    }
+
+    /// <summary>
+    /// Удержание манёвра заданное время
+    /// </summary>
+    /// <returns>false, если манёвр вытеснен новой командой или исполнитель остановлен</returns>
+    bool holdFor(const double seconds, const std::uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        const bool interrupted = _cond_var.wait_for(lock, std::chrono::duration<double>(seconds), [&]() {
+            return _generation != generation || !_running;
+        });
+        return !interrupted;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef DRONE_MISSION_HPP
+#define DRONE_MISSION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "AsyncLog.hpp"
+#include "DroneBackend.hpp"
+#include "DroneCommandExecutor.hpp"
+#include "DroneRpc.hpp"
+#include "DroneTelemetry.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Параметры выполнения миссий
+/// </summary>
+struct MissionSettings
+{
+    // Точка считается достигнутой на этом расстоянии, м
+    float acceptance_radius = 1.0f;
+    // Период проверки положения и публикации хода миссии
+    std::chrono::milliseconds poll_period{ 100 };
+    // Запас времени на участок: расчётное время умножается на коэффициент
+    // и к нему добавляется постоянная часть
+    double leg_timeout_factor = 3.0;
+    double leg_timeout_margin = 10.0;
+};
+
+/// <summary>
+/// Выполнение загруженного маршрута на сервере.
+/// Миссия выполняется исполнителем команд как долгий шаг манёвра,
+/// поэтому любая другая команда вытесняет её так же, как обычный манёвр.
+/// Пауза, продолжение и прерывание только выставляют флаги и не вытесняют миссию.
+/// </summary>
+class DroneMission
+{
+private:
+    DroneBackend& _client;
+    TelemetryPublisher& _telemetry;
+    MissionSettings _settings;
+    std::atomic<MissionState> _state{ MissionState::Idle };
+    std::atomic<bool> _pause_requested{ false };
+    std::atomic<bool> _abort_requested{ false };
+
+public:
+    DroneMission(DroneBackend& client, TelemetryPublisher& telemetry, const MissionSettings& settings = MissionSettings())
+        : _client(client),
+          _telemetry(telemetry),
+          _settings(settings)
+    {
+    }
+
+    DroneMission(const DroneMission&) = delete;
+    DroneMission& operator=(const DroneMission&) = delete;
+
+    /// <summary>
+    /// Разбор маршрута из данных запроса и создание манёвра миссии
+    /// </summary>
+    /// <param name="mission_id">Идентификатор миссии, публикуется в ходе выполнения</param>
+    /// <param name="payload">Массив MissionWaypoint</param>
+    /// <returns>Пусто, если маршрут пуст или повреждён</returns>
+    std::optional<Maneuver> plan(const std::uint32_t mission_id, const std::byte* payload, const std::size_t payload_size)
+    {
+        if (payload == nullptr || payload_size == 0 || payload_size % sizeof(MissionWaypoint) != 0) {
+            DRONE_LOG_WARN("Неверный размер маршрута миссии: {}", payload_size);
+            return std::nullopt;
+        }
+        const std::size_t count = payload_size / sizeof(MissionWaypoint);
+        if (count > MAX_MISSION_WAYPOINTS) {
+            DRONE_LOG_WARN("Слишком много точек маршрута: {}", count);
+            return std::nullopt;
+        }
+
+        // Точки копируются: буфер сообщения освобождается до начала миссии
+        auto waypoints = std::make_shared<std::vector<MissionWaypoint>>(count);
+        std::memcpy(waypoints->data(), payload, payload_size);
+        for (const MissionWaypoint& waypoint : *waypoints) {
+            if (!(waypoint.velocity > 0.0f)) {
+                DRONE_LOG_WARN("Неверная скорость на участке миссии: {}", waypoint.velocity);
+                return std::nullopt;
+            }
+        }
+
+        Maneuver maneuver;
+        maneuver.method = DroneMethods::MissionUpload;
+        maneuver.task = [this, mission_id, waypoints](const ManeuverHold& hold) {
+            return run(mission_id, *waypoints, hold);
+        };
+        return maneuver;
+    }
+
+    /// <summary>
+    /// Пауза: дрон зависает на месте до продолжения
+    /// </summary>
+    /// <returns>false, если миссия не выполняется</returns>
+    bool pause()
+    {
+        if (_state.load() != MissionState::Running) {
+            return false;
+        }
+        _pause_requested = true;
+        return true;
+    }
+
+    /// <summary>
+    /// Продолжение с участка, на котором миссия была приостановлена
+    /// </summary>
+    bool resume()
+    {
+        if (_state.load() != MissionState::Paused && !_pause_requested.load()) {
+            return false;
+        }
+        _pause_requested = false;
+        return true;
+    }
+
+    /// <summary>
+    /// Прерывание миссии с переходом в зависание
+    /// </summary>
+    bool abort()
+    {
+        const MissionState state = _state.load();
+        if (state != MissionState::Running && state != MissionState::Paused) {
+            return false;
+        }
+        _abort_requested = true;
+        return true;
+    }
+
+    MissionState state() const
+    {
+        return _state.load();
+    }
+
+private:
+    /// <summary>
+    /// Выполнение маршрута в потоке исполнителя
+    /// </summary>
+    bool run(const std::uint32_t mission_id, const std::vector<MissionWaypoint>& waypoints, const ManeuverHold& hold)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        _pause_requested = false;
+        _abort_requested = false;
+        MissionProgressRep progress;
+        progress.mission_id = mission_id;
+        progress.waypoint_count = static_cast<std::uint16_t>(waypoints.size());
+        const double poll_seconds = std::chrono::duration<double>(_settings.poll_period).count();
+
+        try {
+            const Vector3r origin = _client.position();
+            setState(progress, MissionState::Running);
+
+            for (std::size_t index = 0; index < waypoints.size(); ++index) {
+                const MissionWaypoint& waypoint = waypoints[index];
+                Vector3r target(waypoint.x, waypoint.y, waypoint.z);
+                if (waypoint.relative) {
+                    target = Vector3r(origin.x() + waypoint.x, origin.y() + waypoint.y, origin.z() + waypoint.z);
+                }
+                progress.waypoint_index = static_cast<std::uint16_t>(index);
+
+                bool issued = false;
+                Clock::time_point deadline{};
+                while (true) {
+                    if (_abort_requested.load()) {
+                        _client.hover();
+                        setState(progress, MissionState::Aborted);
+                        return false;
+                    }
+
+                    if (_pause_requested.load()) {
+                        if (_state.load() != MissionState::Paused) {
+                            _client.hover();
+                            setState(progress, MissionState::Paused);
+                            issued = false;
+                        }
+                        if (!hold(poll_seconds)) {
+                            setState(progress, MissionState::Preempted);
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    const Vector3r position = _client.position();
+                    progress.distance = distance(position, target);
+                    if (!issued) {
+                        // Участок (заново после паузы) с отсчётом времени от текущего положения
+                        if (_state.load() == MissionState::Paused) {
+                            setState(progress, MissionState::Running);
+                        }
+                        _client.moveToPosition(target, waypoint.velocity, static_cast<DrivetrainType>(waypoint.drivetrain),
+                                               YawMode(waypoint.yaw_is_rate, waypoint.yaw_or_rate));
+                        issued = true;
+                        const double leg_seconds = progress.distance / waypoint.velocity * _settings.leg_timeout_factor
+                                                   + _settings.leg_timeout_margin;
+                        deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(leg_seconds));
+                    }
+
+                    publish(progress);
+                    if (progress.distance <= _settings.acceptance_radius) {
+                        break;
+                    }
+                    if (Clock::now() > deadline) {
+                        DRONE_LOG_WARN("Точка маршрута {} не достигнута, расстояние: {}", index, progress.distance);
+                        _client.hover();
+                        setState(progress, MissionState::Failed);
+                        return false;
+                    }
+                    if (!hold(poll_seconds)) {
+                        setState(progress, MissionState::Preempted);
+                        return false;
+                    }
+                }
+            }
+        }
+        catch (...) {
+            DRONE_LOG_ERROR("Exception raised by the API, something went wrong.\n{}", backendErrorMessage());
+            setState(progress, MissionState::Failed);
+            return false;
+        }
+
+        progress.distance = 0.0f;
+        setState(progress, MissionState::Completed);
+        return true;
+    }
+
+    void setState(MissionProgressRep& progress, const MissionState state)
+    {
+        _state = state;
+        progress.state = state;
+        publish(progress);
+    }
+
+    void publish(MissionProgressRep& progress)
+    {
+        progress.time_point = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        _telemetry.publish(DroneSensors::MissionProgress, progress);
+    }
+
+    static float distance(const Vector3r& a, const Vector3r& b)
+    {
+        const float dx = a.x() - b.x();
+        const float dy = a.y() - b.y();
+        const float dz = a.z() - b.z();
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+};
+}
+
+#endif
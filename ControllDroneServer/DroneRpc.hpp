@@ -6,11 +6,8 @@
 #include <string>
 #include <map>
 
-
 namespace drone
 {
-constexpr std::uint32_t MSG_BUFFER_SIZE = 1024 * 20;
-
 /// <summary>
 /// Сенсоры на борту дрона
 /// </summary>
@@ -19,7 +16,9 @@ enum class DroneSensors
     Barometer,
     Imu,
     Gps,
-    Magnetometer
+    Magnetometer,
+    // Не сенсор: ход выполнения миссии, публикуется в потоке телеметрии
+    MissionProgress
 };
 
 /// <summary>
@@ -49,9 +48,29 @@ enum class DroneMethods : int
     ToForward,
     ToBack,
     RotateLeft,
-    RotateRight
+    RotateRight,
+    // Непрерывное управление: уставка скорости, повторяется с постоянной частотой
+    VelocitySetpoint,
+    // Миссия: маршрут передаётся в данных запроса и выполняется на сервере
+    MissionUpload,
+    MissionPause,
+    MissionResume,
+    MissionAbort,
+    // Визуальное сопровождение: положение цели в кадре, регулятор работает на сервере
+    VisualServoTarget,
+    VisualServoStop,
+    // Статистика задержек сервера, записи передаются в данных ответа
+    Stats,
+    // Глубина по областям кадра: области DepthRoiReq в данных запроса,
+    // оценки DepthSampleRep в том же порядке в данных ответа
+    DepthQuery
 };
 
+/// <summary>
+/// Число команд, размер таблиц, индексируемых командой
+/// </summary>
+constexpr std::size_t DRONE_METHOD_COUNT = static_cast<std::size_t>(DroneMethods::DepthQuery) + 1;
+
 /// <summary>
 /// Список камер дрона
 /// </summary>
@@ -64,6 +83,8 @@ enum class DroneCamera : int
     back_center
 };
 
+constexpr std::size_t CAMERA_COUNT = 5;
+
 static std::map<DroneCamera, std::string> map_cameras = {
     { DroneCamera::front_center, "front-center" },
     { DroneCamera::front_right,  "front-right"  },
@@ -72,6 +93,112 @@ static std::map<DroneCamera, std::string> map_cameras = {
     { DroneCamera::back_center,  "back-center"  }
 };
 
+/// <summary>
+/// Кодирование изображения в кадре
+/// </summary>
+enum class ImageEncoding : std::uint8_t
+{
+    Png = 0,
+    Bgr8,       // несжатые пиксели BGR, 3 байта на точку
+    Jpeg,
+    Lz4Bgr      // пиксели BGR, сжатые LZ4
+};
+
+/// <summary>
+/// Состояние команды в ответе
+/// </summary>
+enum class ReplyStatus : std::uint8_t
+{
+    Accepted = 0, // команда принята (ответ сразу после постановки)
+    Completed,    // манёвр выполнен
+    Preempted,    // манёвр вытеснен следующей командой
+    Rejected,     // команда не поддерживается или не может прервать команду старшего класса
+    Expired,      // срок действия запроса истёк до разбора, команда не выполнялась
+    Failed        // ошибка AirSim при выполнении манёвра
+};
+
+/// <summary>
+/// Состояние миссии
+/// </summary>
+enum class MissionState : std::uint8_t
+{
+    Idle = 0,
+    Running,
+    Paused,
+    Completed,
+    Aborted,   // прервана командой MissionAbort
+    Preempted, // вытеснена другой командой
+    Failed     // точка маршрута не достигнута за отведённое время
+};
+
+/// <summary>
+/// Наибольшее число точек маршрута в одной миссии
+/// </summary>
+constexpr std::size_t MAX_MISSION_WAYPOINTS = 1024;
+
+/// <summary>
+/// Точка маршрута миссии, массив точек передаётся в данных запроса MissionUpload
+/// </summary>
+#pragma pack(push, 1)
+struct MissionWaypoint
+{
+    float x = 0.0f; // NED, м
+    float y = 0.0f;
+    float z = 0.0f;
+    float velocity = 5.0f; // скорость на участке до точки, м/с
+    bool yaw_is_rate = false;
+    float yaw_or_rate = 0.0f;
+    int drivetrain = 0; // DrivetrainType::MaxDegreeOfFreedom
+    bool relative = false; // координаты относительно положения дрона при запуске миссии
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Способ оценки глубины по области кадра
+/// </summary>
+enum class DepthEstimator : std::uint8_t
+{
+    Median = 0,
+    TrimmedMean // среднее без 25% крайних значений с каждой стороны
+};
+
+/// <summary>
+/// Наибольшее число областей в одном запросе DepthQuery
+/// </summary>
+constexpr std::size_t MAX_DEPTH_ROIS = 64;
+
+/// <summary>
+/// Область кадра для оценки глубины, массив областей передаётся в данных запроса DepthQuery.
+/// Камера берётся из поля camera запроса.
+/// </summary>
+#pragma pack(push, 1)
+struct DepthRoiReq
+{
+    // Центр области: смещение от центра кадра, нормированное на половину
+    // ширины и высоты кадра, -1..1, как положение цели в VisualServoTarget
+    float x = 0.0f; // вправо
+    float y = 0.0f; // вниз
+    std::uint16_t half_size = 2; // полуразмер квадратного окна в пикселях кадра глубины
+    DepthEstimator estimator = DepthEstimator::Median;
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Оценка глубины для области, массив оценок передаётся в данных ответа DepthQuery
+/// </summary>
+#pragma pack(push, 1)
+struct DepthSampleRep
+{
+    bool valid = false;
+    std::float_t depth = 0.0f;    // глубина вдоль оптической оси, м
+    std::float_t distance = 0.0f; // расстояние от камеры до точки, м
+    std::float_t x = 0.0f;        // точка в системе камеры, м
+    std::float_t y = 0.0f;
+    std::float_t z = 0.0f;
+    std::uint32_t pixels = 0;     // число достоверных пикселей в области
+};
+#pragma pack(pop)
+
 /// <summary>
 /// Запрос на выполнение команды
 /// </summary>
@@ -79,6 +206,8 @@ static std::map<DroneCamera, std::string> map_cameras = {
 struct DroneMethodReq
 {
     DroneMethods method;
+    // Монотонное время клиента при создании запроса, мкс; старые клиенты
+    // без deadline_us передают секунды от эпохи
     std::uint64_t time_point = 0;
     bool yaw_is_rate = true;
     float yaw_or_rate = 0.0f; // угол рысканья
@@ -86,6 +215,25 @@ struct DroneMethodReq
     int drivetrain = 1; // DrivetrainType::ForwardOnly;
     bool get_camera_image = false;
     DroneCamera camera = DroneCamera::front_center;
+    // Новые поля только в конец: сервер принимает и более короткие запросы
+    ImageEncoding image_encoding = ImageEncoding::Jpeg;
+    std::uint32_t request_id = 0; // возвращается в ответе без изменений
+    std::uint8_t vehicle_id = 0;  // номер дрона в реестре сервера
+    // Уставка скорости для VelocitySetpoint в связанной с дроном системе, м/с;
+    // скорость рысканья, град/с, передаётся в yaw_or_rate
+    float velocity_x = 0.0f; // вперёд
+    float velocity_y = 0.0f; // вправо
+    float velocity_z = 0.0f; // вниз
+    // Положение цели для VisualServoTarget: смещение от центра кадра,
+    // нормированное на половину ширины и высоты кадра, -1..1
+    float target_x = 0.0f; // вправо
+    float target_y = 0.0f; // вниз
+    // Срок действия запроса от time_point, мкс; 0 - без срока.
+    // Просроченные команды управления сервер не выполняет и отвечает Expired
+    std::uint32_t deadline_us = 0;
+    // Случайный номер запуска клиента, один на процесс; 0 - не задан.
+    // По нему сервер отличает часы клиентов, пишущих в один сокет
+    std::uint64_t client_session = 0;
 };
 #pragma pack(pop)
 
@@ -162,6 +310,113 @@ struct DroneReply
     ImuSensorDataRep imu;
     GpsSensorDataRep gps;
     MagnetometerSensorDataRep magnetometer;
+    std::uint32_t request_id = 0; // идентификатор запроса, на который дан ответ
+    ReplyStatus status = ReplyStatus::Accepted;
+    std::uint8_t vehicle_id = 0; // номер дрона, выполнившего команду
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Этап обработки, для которого собирается гистограмма задержек
+/// </summary>
+enum class LatencyStage : std::uint8_t
+{
+    // Команды
+    QueueWait = 0, // приём - извлечение из очереди входящих
+    Dispatch,      // извлечение - постановка исполнителю или ответ
+    Execution,     // вызовы AirSim в шагах манёвра
+    ReplyWait,     // постановка ответа - отправка в сокет
+    Total,         // приём - отправка ответа
+    // Камеры
+    FrameCapture,  // запрос кадров к AirSim
+    FrameSend,     // получение кадра - отправка в сокет
+    // Команды со сроком действия: число записей - выполненные и просроченные команды
+    RequestAge,    // возраст выполненной команды при разборе
+    Expired,       // возраст отброшенной просроченной команды
+    // Ответы, отброшенные из-за того, что клиент не принимает сообщения:
+    // число записей - потерянные ответы, значение - время с постановки ответа
+    ReplyDropped
+};
+
+constexpr std::size_t LATENCY_STAGE_COUNT = static_cast<std::size_t>(LatencyStage::ReplyDropped) + 1;
+
+/// <summary>
+/// Источник задержек в записи статистики
+/// </summary>
+enum class LatencySource : std::uint8_t
+{
+    Method = 0, // id - значение DroneMethods
+    Camera      // id - значение DroneCamera
+};
+
+/// <summary>
+/// Запись статистики задержек, массив записей передаётся в данных ответа Stats
+/// </summary>
+#pragma pack(push, 1)
+struct LatencyStatsRep
+{
+    LatencySource source = LatencySource::Method;
+    std::uint8_t id = 0;
+    LatencyStage stage = LatencyStage::Total;
+    std::uint8_t reserved = 0;
+    std::uint64_t count = 0;
+    std::uint32_t p50_us = 0;
+    std::uint32_t p99_us = 0;
+    std::uint32_t max_us = 0;
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Ход выполнения миссии
+/// </summary>
+#pragma pack(push, 1)
+struct MissionProgressRep
+{
+    std::uint64_t time_point = 0;
+    std::uint32_t mission_id = 0; // идентификатор запроса MissionUpload
+    MissionState state = MissionState::Idle;
+    std::uint16_t waypoint_index = 0; // точка, к которой летит дрон
+    std::uint16_t waypoint_count = 0;
+    std::float_t distance = 0.0f; // расстояние до точки, м
+};
+#pragma pack(pop)
+
+/// <summary>
+/// Заголовок сообщения телеметрии, за ним следует структура ответа сенсора
+/// </summary>
+#pragma pack(push, 1)
+struct TelemetrySampleHeader
+{
+    DroneSensors sensor;
+    std::uint8_t vehicle_id = 0; // номер дрона в реестре сервера
+};
+#pragma pack(pop)
+
+constexpr std::uint32_t IMAGE_FRAME_MAGIC = 0x4D524644; // "DFRM"
+constexpr std::uint16_t IMAGE_FRAME_VERSION = 1;
+
+/// <summary>
+/// Заголовок кадра камеры, за ним следует payload_size байт изображения.
+/// Новые поля добавляются только в конец, header_size позволяет
+/// пропустить неизвестный хвост заголовка.
+/// </summary>
+#pragma pack(push, 1)
+struct ImageFrameHeader
+{
+    std::uint32_t magic = IMAGE_FRAME_MAGIC;
+    std::uint16_t version = IMAGE_FRAME_VERSION;
+    std::uint16_t header_size = sizeof(ImageFrameHeader);
+    std::uint64_t sequence = 0;   // номер кадра камеры, сквозной
+    std::uint64_t time_stamp = 0; // время захвата AirSim, нс
+    DroneCamera camera = DroneCamera::front_center;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    ImageEncoding encoding = ImageEncoding::Png;
+    std::uint8_t vehicle_id = 0; // номер дрона в реестре сервера
+    std::uint8_t reserved[2] = {};
+    std::float_t position[3] = {};    // положение камеры x, y, z
+    std::float_t orientation[4] = {}; // ориентация камеры w, x, y, z
+    std::uint32_t payload_size = 0;
 };
 #pragma pack(pop)
 
@@ -0,0 +1,248 @@
+#ifndef DRONE_TELEMETRY_HPP
+#define DRONE_TELEMETRY_HPP
+
+#include "common/common_utils/StrictMode.hpp"
+STRICT_MODE_OFF
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+#include "rpc/rpc_error.h"
+STRICT_MODE_ON
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <compat/nanomsg/nn.h>
+#include <compat/nanomsg/pubsub.h>
+
+#include "AsyncLog.hpp"
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+#include "FlightRecorder.hpp"
+#include "TimerWheel.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Частоты опроса сенсоров, Гц (0 - сенсор не публикуется)
+/// </summary>
+struct TelemetryRates
+{
+    double barometer_hz = 20.0;
+    double imu_hz = 100.0;
+    double gps_hz = 10.0;
+    double magnetometer_hz = 20.0;
+};
+
+/// <summary>
+/// Публикация телеметрии через сокет PUB.
+/// Сенсоры опрашиваются в отдельном потоке со своей частотой по колесу таймеров,
+/// последние значения доступны для ответов на команды без обращения к AirSim.
+/// </summary>
+class TelemetryPublisher
+{
+private:
+    static constexpr std::size_t SENSOR_COUNT = 4;
+    static constexpr std::chrono::milliseconds TICK{ 1 };
+
+    DroneBackend& _client;
+    std::uint8_t _vehicle_id = 0;
+    TelemetryRates _rates;
+    std::atomic<int> _sock{ -1 }; // публикация миссии идёт из потока исполнителя
+    std::atomic<FlightRecorder*> _recorder{ nullptr };
+    std::atomic<bool> _running{ false };
+    std::thread _thread;
+    TimerWheel _wheel;
+    std::array<std::uint64_t, SENSOR_COUNT> _period_ticks{};
+
+    // Последние значения сенсоров
+    mutable std::mutex _mtx;
+    BarometerSensorDataRep _barometer;
+    ImuSensorDataRep _imu;
+    GpsSensorDataRep _gps;
+    MagnetometerSensorDataRep _magnetometer;
+
+public:
+    /// <summary>
+    /// Создание публикации телеметрии одного дрона
+    /// </summary>
+    /// <param name="vehicle_id">Номер дрона, записывается в заголовок сообщения</param>
+    explicit TelemetryPublisher(DroneBackend& client, const std::uint8_t vehicle_id = 0)
+        : _client(client),
+          _vehicle_id(vehicle_id)
+    {
+    }
+
+    ~TelemetryPublisher()
+    {
+        stop();
+    }
+
+    TelemetryPublisher(const TelemetryPublisher&) = delete;
+    TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+    /// <summary>
+    /// Запуск потока опроса
+    /// </summary>
+    /// <param name="sock">Сокет PUB, общий для всех дронов</param>
+    /// <param name="rates">Частоты опроса сенсоров</param>
+    void start(int sock, const TelemetryRates& rates)
+    {
+        _rates = rates;
+        _sock = sock;
+
+        const double sensor_rates[SENSOR_COUNT] = { _rates.barometer_hz, _rates.imu_hz, _rates.gps_hz, _rates.magnetometer_hz };
+        const double tick_hz = 1000.0 / static_cast<double>(TICK.count());
+        for (std::size_t sensor = 0; sensor < SENSOR_COUNT; ++sensor) {
+            if (sensor_rates[sensor] <= 0.0) {
+                continue;
+            }
+            _period_ticks[sensor] = static_cast<std::uint64_t>(std::max(1.0, std::round(tick_hz / sensor_rates[sensor])));
+            _wheel.schedule(sensor, _period_ticks[sensor]);
+        }
+
+        _running = true;
+        _thread = std::thread(&TelemetryPublisher::loop, this);
+    }
+
+    /// <summary>
+    /// Остановка потока, сокет закрывает владелец
+    /// </summary>
+    void stop()
+    {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+        _sock = -1;
+    }
+
+    /// <summary>
+    /// Копирование последних значений сенсоров в ответ
+    /// </summary>
+    void latest(DroneReply& reply) const
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        reply.barometer = _barometer;
+        reply.imu = _imu;
+        reply.gps = _gps;
+        reply.magnetometer = _magnetometer;
+    }
+
+private:
+    /// <summary>
+    /// Цикл опроса сенсоров
+    /// </summary>
+    void loop()
+    {
+        // Колесо продвигается на число шагов, прошедших по часам: медленный
+        // опрос или грубый таймер сна не замедляют частоты сенсоров, а
+        // просроченный сенсор опрашивается один раз, без серии опросов
+        auto wheel_time = std::chrono::steady_clock::now();
+        while (_running) {
+            std::this_thread::sleep_until(wheel_time + TICK);
+            const auto ticks = (std::chrono::steady_clock::now() - wheel_time) / TICK;
+            if (ticks <= 0) {
+                continue;
+            }
+            wheel_time += ticks * TICK;
+            _wheel.advance(static_cast<std::uint64_t>(ticks), [this](const std::size_t sensor, const std::uint64_t late) {
+                poll(static_cast<DroneSensors>(sensor));
+                // Следующий опрос по прежнему расписанию, пропущенные периоды не повторяются
+                const std::uint64_t period = _period_ticks[sensor];
+                _wheel.schedule(sensor, period - late % period);
+            });
+        }
+    }
+
+    /// <summary>
+    /// Опрос сенсора и публикация значения
+    /// </summary>
+    void poll(const DroneSensors sensor)
+    {
+        try {
+            switch (sensor) {
+            case DroneSensors::Barometer: {
+                const BarometerSensorDataRep data = _client.barometerData();
+                store(_barometer, data);
+                publish(sensor, data);
+                break;
+            }
+            case DroneSensors::Imu: {
+                const ImuSensorDataRep data = _client.imuData();
+                store(_imu, data);
+                publish(sensor, data);
+                break;
+            }
+            case DroneSensors::Gps: {
+                const GpsSensorDataRep data = _client.gpsData();
+                store(_gps, data);
+                publish(sensor, data);
+                break;
+            }
+            case DroneSensors::Magnetometer: {
+                const MagnetometerSensorDataRep data = _client.magnetometerData();
+                store(_magnetometer, data);
+                publish(sensor, data);
+                break;
+            }
+            case DroneSensors::MissionProgress:
+                break;
+            }
+        }
+        catch (...) {
+            DRONE_LOG_ERROR("Ошибка опроса сенсора {}: {}", sensor, backendErrorMessage());
+        }
+    }
+
+    template <typename Rep>
+    void store(Rep& target, const Rep& data)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        target = data;
+    }
+
+public:
+    /// <summary>
+    /// Запись публикуемых сообщений в журнал полёта, nullptr - без записи
+    /// </summary>
+    void setRecorder(FlightRecorder* recorder)
+    {
+        _recorder = recorder;
+    }
+
+    /// <summary>
+    /// Публикация сообщения в поток телеметрии, можно вызывать из любого потока
+    /// </summary>
+    template <typename Rep>
+    void publish(const DroneSensors sensor, const Rep& data)
+    {
+        const int sock = _sock.load();
+        if (sock < 0) {
+            return;
+        }
+        const TelemetrySampleHeader header{ sensor, _vehicle_id };
+        if (FlightRecorder* recorder = _recorder.load()) {
+            recorder->record(FlightRecordKind::Sensor, _vehicle_id, &header, sizeof(header), &data, sizeof(data));
+        }
+        void* msg = nn_allocmsg(sizeof(header) + sizeof(data), 0);
+        if (msg == nullptr) {
+            return;
+        }
+        std::memcpy(msg, &header, sizeof(header));
+        std::memcpy(static_cast<char*>(msg) + sizeof(header), &data, sizeof(data));
+        if (nn_send(sock, &msg, NN_MSG, NN_DONTWAIT) < 0) {
+            nn_freemsg(msg);
+        }
+    }
+};
+}
+
+#endif
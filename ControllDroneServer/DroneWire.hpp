@@ -0,0 +1,310 @@
+#ifndef DRONE_WIRE_HPP
+#define DRONE_WIRE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#include "DroneRpc.hpp"
+
+// Все поля передаются в порядке little-endian, как они лежат в памяти на x86/x64 и ARM
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "Протокол DroneWire рассчитан только на little-endian платформы"
+#endif
+
+namespace drone
+{
+constexpr std::uint16_t WIRE_MAGIC = 0x5244; // "DR"
+constexpr std::uint8_t WIRE_VERSION = 1;
+
+/// <summary>
+/// Тип сообщения протокола
+/// </summary>
+enum class WireKind : std::uint8_t
+{
+    Request = 1,
+    Reply
+};
+
+/// <summary>
+/// Конверт сообщения: заголовок, тело (структура схемы) и необязательные данные.
+/// Размеры заголовка и тела передаются явно, поэтому получатель пропускает
+/// неизвестный хвост и подставляет значения по умолчанию для отсутствующих полей.
+/// </summary>
+#pragma pack(push, 1)
+struct WireHeader
+{
+    std::uint16_t magic = WIRE_MAGIC;
+    std::uint8_t version = WIRE_VERSION;
+    WireKind kind = WireKind::Request;
+    std::uint16_t header_size = sizeof(WireHeader);
+    std::uint16_t body_size = 0;
+    std::uint32_t payload_size = 0;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(WireHeader) == 12, "WireHeader layout changed");
+
+//
+// Схема тел сообщений: тип, имя и смещение поля.
+// Поля только добавляются в конец, смещения существующих полей не меняются.
+//
+#define DRONE_METHOD_REQ_SCHEMA(FIELD)                 \
+    FIELD(DroneMethods,  method,            0)         \
+    FIELD(std::uint64_t, time_point,        4)         \
+    FIELD(bool,          yaw_is_rate,       12)        \
+    FIELD(float,         yaw_or_rate,       13)        \
+    FIELD(float,         speed,             17)        \
+    FIELD(int,           drivetrain,        21)        \
+    FIELD(bool,          get_camera_image,  25)        \
+    FIELD(DroneCamera,   camera,            26)        \
+    FIELD(ImageEncoding, image_encoding,    30)        \
+    FIELD(std::uint32_t, request_id,        31)         \
+    FIELD(std::uint8_t,  vehicle_id,        35)         \
+    FIELD(float,         velocity_x,        36)         \
+    FIELD(float,         velocity_y,        40)         \
+    FIELD(float,         velocity_z,        44)         \
+    FIELD(float,         target_x,          48)         \
+    FIELD(float,         target_y,          52)        \
+    FIELD(std::uint32_t, deadline_us,       56)        \
+    FIELD(std::uint64_t, client_session,    60)
+
+#define DRONE_REPLY_SCHEMA(FIELD)                               \
+    FIELD(DroneMethods,              method,        0)          \
+    FIELD(BarometerSensorDataRep,    barometer,     4)          \
+    FIELD(ImuSensorDataRep,          imu,           24)         \
+    FIELD(GpsSensorDataRep,          gps,           56)         \
+    FIELD(MagnetometerSensorDataRep, magnetometer,  105)        \
+    FIELD(std::uint32_t,             request_id,    125)        \
+    FIELD(ReplyStatus,               status,        129)        \
+    FIELD(std::uint8_t,              vehicle_id,    130)
+
+// Проверка, что схема совпадает с раскладкой структур
+#define DRONE_WIRE_ASSERT_OFFSET(Layout, type, name, offset)                                 \
+    static_assert(offsetof(Layout, name) == (offset), #Layout "::" #name " offset mismatch"); \
+    static_assert(sizeof(Layout::name) == sizeof(type), #Layout "::" #name " size mismatch");
+
+#define DRONE_WIRE_ASSERT_REQ(type, name, offset) DRONE_WIRE_ASSERT_OFFSET(DroneMethodReq, type, name, offset)
+#define DRONE_WIRE_ASSERT_REPLY(type, name, offset) DRONE_WIRE_ASSERT_OFFSET(DroneReply, type, name, offset)
+DRONE_METHOD_REQ_SCHEMA(DRONE_WIRE_ASSERT_REQ)
+DRONE_REPLY_SCHEMA(DRONE_WIRE_ASSERT_REPLY)
+#undef DRONE_WIRE_ASSERT_REQ
+#undef DRONE_WIRE_ASSERT_REPLY
+#undef DRONE_WIRE_ASSERT_OFFSET
+
+static_assert(sizeof(DroneMethodReq) == 68, "DroneMethodReq layout changed");
+static_assert(sizeof(DroneReply) == 131, "DroneReply layout changed");
+
+//
+// Генерация методов доступа: поле читается прямо из буфера сообщения,
+// отсутствующее в более коротком теле поле возвращает значение по умолчанию.
+//
+#define DRONE_WIRE_ACCESSOR(type, name, offset)                        \
+    bool has_##name() const                                            \
+    {                                                                  \
+        return _size >= (offset) + sizeof(type);                       \
+    }                                                                  \
+    type name() const                                                  \
+    {                                                                  \
+        if (!has_##name()) {                                           \
+            return defaults().name;                                    \
+        }                                                              \
+        type value;                                                    \
+        std::memcpy(&value, _data + (offset), sizeof(type));           \
+        return value;                                                  \
+    }
+
+#define DRONE_WIRE_COPY_FIELD(type, name, offset) \
+    layout.name = name();
+
+/// <summary>
+/// Представление тела сообщения поверх буфера, без копирования
+/// </summary>
+template <typename Layout>
+class WireView
+{
+protected:
+    const std::byte* _data = nullptr;
+    std::size_t _size = 0;
+
+    static const Layout& defaults()
+    {
+        static const Layout value{};
+        return value;
+    }
+
+public:
+    WireView(const std::byte* data, const std::size_t size)
+        : _data(data),
+          _size(size)
+    {
+    }
+
+    /// <summary>
+    /// Размер тела в сообщении
+    /// </summary>
+    std::size_t size() const
+    {
+        return _size;
+    }
+};
+
+/// <summary>
+/// Запрос на выполнение команды, поля читаются из буфера
+/// </summary>
+class DroneMethodReqView : public WireView<DroneMethodReq>
+{
+public:
+    using WireView::WireView;
+
+    DRONE_METHOD_REQ_SCHEMA(DRONE_WIRE_ACCESSOR)
+
+    /// <summary>
+    /// Копия запроса, например для передачи в другой поток
+    /// </summary>
+    DroneMethodReq value() const
+    {
+        DroneMethodReq layout;
+        DRONE_METHOD_REQ_SCHEMA(DRONE_WIRE_COPY_FIELD)
+        return layout;
+    }
+};
+
+/// <summary>
+/// Ответ сервера, поля читаются из буфера
+/// </summary>
+class DroneReplyView : public WireView<DroneReply>
+{
+public:
+    using WireView::WireView;
+
+    DRONE_REPLY_SCHEMA(DRONE_WIRE_ACCESSOR)
+};
+
+#undef DRONE_WIRE_ACCESSOR
+#undef DRONE_WIRE_COPY_FIELD
+
+/// <summary>
+/// Разобранное сообщение: тело и данные после него
+/// </summary>
+template <typename View>
+struct WireMessage
+{
+    View body;
+    const std::byte* payload = nullptr;
+    std::size_t payload_size = 0;
+    bool framed = true; // false - сообщение старого формата без заголовка
+};
+
+/// <summary>
+/// Проверка заголовка и разбор сообщения.
+/// Сообщение без заголовка считается телом старого формата (первое поле
+/// старых запросов - номер метода, он не может совпасть с WIRE_MAGIC).
+/// </summary>
+/// <returns>Пусто, если сообщение повреждено или другого типа</returns>
+template <typename View>
+std::optional<WireMessage<View>> decodeWire(const std::byte* data, const std::size_t size, const WireKind kind)
+{
+    std::uint16_t magic = 0;
+    if (size >= sizeof(magic)) {
+        std::memcpy(&magic, data, sizeof(magic));
+    }
+    if (magic != WIRE_MAGIC) {
+        return WireMessage<View>{ View(data, size), nullptr, 0, false };
+    }
+
+    if (size < sizeof(WireHeader)) {
+        return std::nullopt;
+    }
+    WireHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const std::size_t total = static_cast<std::size_t>(header.header_size) + header.body_size + header.payload_size;
+    if (header.version != WIRE_VERSION || header.kind != kind
+        || header.header_size < sizeof(WireHeader) || total > size) {
+        return std::nullopt;
+    }
+
+    const std::byte* body = data + header.header_size;
+    return WireMessage<View>{ View(body, header.body_size), body + header.body_size, header.payload_size, true };
+}
+
+/// <summary>
+/// Размер сообщения с телом Layout и данными payload_size
+/// </summary>
+template <typename Layout>
+constexpr std::size_t wireSize(const std::size_t payload_size = 0)
+{
+    return sizeof(WireHeader) + sizeof(Layout) + payload_size;
+}
+
+/// <summary>
+/// Запись заголовка в буфер сообщения
+/// </summary>
+/// <returns>Указатель на место тела</returns>
+template <typename Layout>
+std::byte* encodeWireHeader(std::byte* data, const WireKind kind, const std::size_t payload_size = 0)
+{
+    WireHeader header;
+    header.kind = kind;
+    header.body_size = static_cast<std::uint16_t>(sizeof(Layout));
+    header.payload_size = static_cast<std::uint32_t>(payload_size);
+    std::memcpy(data, &header, sizeof(header));
+    return data + sizeof(header);
+}
+
+/// <summary>
+/// Запись заголовка и тела в буфер размером не меньше wireSize<Layout>()
+/// </summary>
+template <typename Layout>
+std::byte* encodeWire(std::byte* data, const WireKind kind, const Layout& body, const std::size_t payload_size = 0)
+{
+    std::byte* body_ptr = encodeWireHeader<Layout>(data, kind, payload_size);
+    std::memcpy(body_ptr, &body, sizeof(Layout));
+    return body_ptr + sizeof(Layout);
+}
+
+/// <summary>
+/// Размер сообщения кадра камеры: заголовок и изображение
+/// </summary>
+inline std::size_t frameSize(const ImageFrameHeader& header)
+{
+    return sizeof(ImageFrameHeader) + header.payload_size;
+}
+
+/// <summary>
+/// Запись кадра в буфер размером не меньше frameSize(header)
+/// </summary>
+/// <param name="image">header.payload_size байт изображения</param>
+inline void encodeFrame(std::byte* data, const ImageFrameHeader& header, const void* image)
+{
+    std::memcpy(data, &header, sizeof(header));
+    if (header.payload_size > 0) {
+        std::memcpy(data + sizeof(header), image, header.payload_size);
+    }
+}
+
+/// <summary>
+/// Проверка и чтение заголовка кадра камеры.
+/// Изображение начинается через header_size байт от начала сообщения,
+/// неизвестный хвост заголовка более новой версии пропускается.
+/// </summary>
+/// <returns>Пусто, если сообщение не является целым кадром</returns>
+inline std::optional<ImageFrameHeader> decodeFrameHeader(const std::byte* data, const std::size_t size)
+{
+    if (size < sizeof(ImageFrameHeader)) {
+        return std::nullopt;
+    }
+    ImageFrameHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != IMAGE_FRAME_MAGIC
+        || header.header_size < sizeof(ImageFrameHeader)
+        || header.header_size > size
+        || header.payload_size > size - header.header_size) {
+        return std::nullopt;
+    }
+    return header;
+}
+}
+
+#endif
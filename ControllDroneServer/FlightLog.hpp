@@ -0,0 +1,286 @@
+#ifndef FLIGHT_LOG_HPP
+#define FLIGHT_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace drone
+{
+//
+// Формат журнала полёта.
+// Файл: заголовок FlightLogHeader, затем записи подряд. Запись - заголовок
+// FlightChunkHeader фиксированного размера и данные, выровненные на 8 байт.
+// При закрытии в конец пишется запись Index с таблицей времени и смещения
+// записей, её смещение и конец данных сохраняются в заголовке файла.
+// Если запись прервана аварийно, индекс отсутствует (index_offset == 0),
+// и записи находятся последовательным проходом по заголовкам до первого
+// заголовка с неверной сигнатурой.
+//
+
+constexpr char FLIGHT_LOG_MAGIC[8] = { 'D', 'R', 'N', 'F', 'L', 'O', 'G', '\0' };
+constexpr std::uint32_t FLIGHT_LOG_VERSION = 1;
+constexpr std::uint32_t FLIGHT_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+constexpr std::size_t FLIGHT_CHUNK_ALIGNMENT = 8;
+
+/// <summary>
+/// Содержимое записи журнала
+/// </summary>
+enum class FlightRecordKind : std::uint16_t
+{
+    Command = 1, // запрос клиента в формате протокола, как принят
+    Reply,       // ответ сервера в формате протокола, как отправлен
+    Sensor,      // TelemetrySampleHeader и структура сенсора
+    Frame,       // ImageFrameHeader и изображение
+    Index        // массив FlightIndexEntry, последняя запись файла
+};
+
+#pragma pack(push, 1)
+struct FlightLogHeader
+{
+    char magic[8] = { 'D', 'R', 'N', 'F', 'L', 'O', 'G', '\0' };
+    std::uint32_t version = FLIGHT_LOG_VERSION;
+    std::uint32_t header_size = sizeof(FlightLogHeader);
+    std::uint64_t start_time = 0;   // время открытия, нс от эпохи
+    std::uint64_t data_end = 0;     // конец последней записи, 0 - файл не закрыт
+    std::uint64_t index_offset = 0; // смещение записи Index, 0 - индекса нет
+    std::uint64_t record_count = 0;
+    std::uint64_t dropped_count = 0; // записи, не попавшие в журнал из-за переполнения очереди
+};
+
+struct FlightChunkHeader
+{
+    std::uint32_t magic = FLIGHT_CHUNK_MAGIC;
+    FlightRecordKind kind = FlightRecordKind::Command;
+    std::uint8_t vehicle_id = 0;
+    std::uint8_t reserved = 0;
+    std::uint32_t size = 0;       // размер данных без выравнивания
+    std::uint32_t reserved2 = 0;
+    std::uint64_t time_point = 0; // нс от эпохи
+    std::uint64_t sequence = 0;   // сквозной номер записи
+};
+
+/// <summary>
+/// Элемент индекса: первая запись очередного интервала времени
+/// </summary>
+struct FlightIndexEntry
+{
+    std::uint64_t time_point = 0;
+    std::uint64_t offset = 0;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FlightLogHeader) == 56, "FlightLogHeader layout changed");
+static_assert(sizeof(FlightChunkHeader) == 32, "FlightChunkHeader layout changed");
+
+/// <summary>
+/// Размер записи в файле с учётом выравнивания
+/// </summary>
+constexpr std::size_t flightChunkSize(const std::size_t data_size)
+{
+    return (sizeof(FlightChunkHeader) + data_size + FLIGHT_CHUNK_ALIGNMENT - 1) & ~(FLIGHT_CHUNK_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// Файл, отображаемый в память окнами.
+/// Смещение окна кратно гранулярности отображения системы.
+/// </summary>
+class MappedFile
+{
+private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+    bool _writable = false;
+    std::byte* _view = nullptr;
+    std::size_t _view_size = 0;
+    std::uint64_t _size = 0;
+
+public:
+    MappedFile() = default;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// <summary>
+    /// Открытие файла
+    /// </summary>
+    /// <param name="writable">true - файл создаётся заново для записи</param>
+    bool open(const std::string& path, const bool writable)
+    {
+        close();
+        _writable = writable;
+#ifdef _WIN32
+        _file = CreateFileA(path.c_str(),
+                            writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+        if (_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size)) {
+            close();
+            return false;
+        }
+        _size = static_cast<std::uint64_t>(size.QuadPart);
+#else
+        _fd = ::open(path.c_str(), writable ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+        if (_fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(_fd, &info) != 0) {
+            close();
+            return false;
+        }
+        _size = static_cast<std::uint64_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    bool isOpen() const
+    {
+#ifdef _WIN32
+        return _file != INVALID_HANDLE_VALUE;
+#else
+        return _fd >= 0;
+#endif
+    }
+
+    std::uint64_t size() const
+    {
+        return _size;
+    }
+
+    /// <summary>
+    /// Изменение размера файла, окно отображения должно быть закрыто
+    /// </summary>
+    bool resize(const std::uint64_t size)
+    {
+        unmap();
+#ifdef _WIN32
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN) || !SetEndOfFile(_file)) {
+            return false;
+        }
+#else
+        if (::ftruncate(_fd, static_cast<off_t>(size)) != 0) {
+            return false;
+        }
+#endif
+        _size = size;
+        return true;
+    }
+
+    /// <summary>
+    /// Отображение части файла, предыдущее окно закрывается
+    /// </summary>
+    /// <param name="offset">Смещение, кратное granularity()</param>
+    /// <returns>nullptr при ошибке</returns>
+    std::byte* map(const std::uint64_t offset, const std::size_t length)
+    {
+        unmap();
+        if (length == 0 || offset + length > _size) {
+            return nullptr;
+        }
+#ifdef _WIN32
+        _mapping = CreateFileMappingA(_file, nullptr, _writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping == nullptr) {
+            return nullptr;
+        }
+        void* view = MapViewOfFile(_mapping,
+                                   _writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                   static_cast<DWORD>(offset >> 32),
+                                   static_cast<DWORD>(offset & 0xFFFFFFFFu),
+                                   length);
+        if (view == nullptr) {
+            CloseHandle(_mapping);
+            _mapping = nullptr;
+            return nullptr;
+        }
+#else
+        void* view = ::mmap(nullptr, length, _writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, _fd,
+                            static_cast<off_t>(offset));
+        if (view == MAP_FAILED) {
+            return nullptr;
+        }
+#endif
+        _view = static_cast<std::byte*>(view);
+        _view_size = length;
+        return _view;
+    }
+
+    void unmap()
+    {
+        if (_view == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(_view);
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+#else
+        ::munmap(_view, _view_size);
+#endif
+        _view = nullptr;
+        _view_size = 0;
+    }
+
+    void close()
+    {
+        unmap();
+#ifdef _WIN32
+        if (_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(_file);
+            _file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+#endif
+        _size = 0;
+    }
+
+    /// <summary>
+    /// Гранулярность смещения окна
+    /// </summary>
+    static std::size_t granularity()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<std::size_t>(info.dwAllocationGranularity);
+#else
+        return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+    }
+};
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef FLIGHT_RECORDER_HPP
+#define FLIGHT_RECORDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FlightLog.hpp"
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Параметры журнала полёта
+/// </summary>
+struct FlightRecorderSettings
+{
+    // Файл растёт окнами этого размера, окно отображается в память целиком
+    std::size_t segment_size = 64 * 1024 * 1024;
+    // Интервал между элементами индекса времени
+    std::chrono::milliseconds index_interval{ 1000 };
+    // Очередь записи: число записей и суммарный объём данных.
+    // При переполнении записи отбрасываются, источники не ждут диск.
+    std::size_t queue_capacity = 4096;
+    std::size_t max_queued_bytes = 256 * 1024 * 1024;
+};
+
+/// <summary>
+/// Журнал полёта: команды, ответы, показания сенсоров и кадры камер
+/// в одном файле, отображаемом в память. Источники только копируют данные
+/// в очередь, запись в файл выполняется в отдельном потоке.
+/// </summary>
+class FlightRecorder
+{
+private:
+    /// <summary>
+    /// Запись, ожидающая сохранения
+    /// </summary>
+    struct PendingRecord
+    {
+        FlightRecordKind kind = FlightRecordKind::Command;
+        std::uint8_t vehicle_id = 0;
+        std::uint64_t time_point = 0;
+        std::vector<std::byte> data;
+    };
+
+    FlightRecorderSettings _settings;
+    RingMessageQueue<PendingRecord> _queue;
+    std::atomic<std::size_t> _queued_bytes{ 0 };
+    std::atomic<std::uint64_t> _dropped{ 0 };
+    std::mutex _mtx; // открытие и закрытие
+    std::thread _thread;
+
+    // Состояние потока записи
+    MappedFile _file;
+    FlightLogHeader _header;
+    std::byte* _view = nullptr;
+    std::uint64_t _view_offset = 0;
+    std::size_t _view_size = 0;
+    std::uint64_t _write_pos = 0;
+    std::uint64_t _sequence = 0;
+    std::uint64_t _next_index_time = 0;
+    std::vector<FlightIndexEntry> _index;
+    bool _failed = false;
+
+public:
+    explicit FlightRecorder(const FlightRecorderSettings& settings = FlightRecorderSettings())
+        : _settings(settings),
+          _queue(settings.queue_capacity)
+    {
+    }
+
+    ~FlightRecorder()
+    {
+        close();
+    }
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    /// <summary>
+    /// Создание файла журнала и запуск потока записи
+    /// </summary>
+    bool open(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        // Очередь закрывается вместе с журналом, поэтому журнал открывается один раз
+        if (_thread.joinable() || _queue.closed()) {
+            return false;
+        }
+        if (!_file.open(path, true)) {
+            std::cerr << "Ошибка создания журнала полёта: " << path << "\n";
+            return false;
+        }
+
+        _header = FlightLogHeader();
+        _header.start_time = now();
+        _write_pos = sizeof(FlightLogHeader);
+        _view = nullptr;
+        _view_offset = 0;
+        _view_size = 0;
+        _sequence = 0;
+        _next_index_time = 0;
+        _index.clear();
+        _failed = false;
+        if (!reserve(0)) {
+            _file.close();
+            return false;
+        }
+        std::memcpy(_view, &_header, sizeof(_header));
+
+        _thread = std::thread(&FlightRecorder::writeLoop, this);
+        std::cout << "Журнал полёта: " << path << '\n';
+        return true;
+    }
+
+    /// <summary>
+    /// Завершение записи: очередь дописывается, в конец файла добавляется индекс
+    /// </summary>
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_thread.joinable()) {
+            return;
+        }
+        _queue.close();
+        _thread.join();
+        finish();
+    }
+
+    /// <summary>
+    /// Запись из двух частей (заголовок и данные), можно вызывать из любого потока.
+    /// Данные копируются, вызывающий поток не ждёт записи на диск.
+    /// </summary>
+    /// <returns>false, если запись отброшена</returns>
+    bool record(const FlightRecordKind kind,
+                const std::uint8_t vehicle_id,
+                const void* head,
+                const std::size_t head_size,
+                const void* body = nullptr,
+                const std::size_t body_size = 0)
+    {
+        const std::size_t size = head_size + body_size;
+        if (_queue.closed() || _queued_bytes.fetch_add(size, std::memory_order_relaxed) + size > _settings.max_queued_bytes) {
+            _queued_bytes.fetch_sub(size, std::memory_order_relaxed);
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        PendingRecord record;
+        record.kind = kind;
+        record.vehicle_id = vehicle_id;
+        record.time_point = now();
+        record.data.resize(size);
+        if (head_size > 0) {
+            std::memcpy(record.data.data(), head, head_size);
+        }
+        if (body_size > 0) {
+            std::memcpy(record.data.data() + head_size, body, body_size);
+        }
+        if (!_queue.try_push(std::move(record))) {
+            _queued_bytes.fetch_sub(size, std::memory_order_relaxed);
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    std::uint64_t droppedCount() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    void writeLoop()
+    {
+        std::vector<PendingRecord> batch;
+        batch.reserve(64);
+        while (true) {
+            batch.clear();
+            if (_queue.pop_batch(std::back_inserter(batch), 64) == 0) {
+                break;
+            }
+            for (PendingRecord& record : batch) {
+                _queued_bytes.fetch_sub(record.data.size(), std::memory_order_relaxed);
+                if (!_failed) {
+                    write(record.kind, record.vehicle_id, record.time_point, record.data.data(), record.data.size());
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Отображение окна, в котором помещается запись размером need с позиции записи
+    /// </summary>
+    bool reserve(const std::size_t need)
+    {
+        if (_view != nullptr && _write_pos + need <= _view_offset + _view_size) {
+            return true;
+        }
+
+        const std::uint64_t granularity = MappedFile::granularity();
+        const std::uint64_t offset = _write_pos / granularity * granularity;
+        const std::uint64_t required = _write_pos - offset + need;
+        const std::uint64_t length = (std::max<std::uint64_t>(required, _settings.segment_size) + granularity - 1)
+                                     / granularity * granularity;
+        if (_file.size() < offset + length && !_file.resize(offset + length)) {
+            std::cerr << "Ошибка увеличения журнала полёта до " << offset + length << " байт\n";
+            _failed = true;
+            return false;
+        }
+        _view = _file.map(offset, static_cast<std::size_t>(length));
+        if (_view == nullptr) {
+            std::cerr << "Ошибка отображения журнала полёта в память\n";
+            _failed = true;
+            return false;
+        }
+        _view_offset = offset;
+        _view_size = static_cast<std::size_t>(length);
+        return true;
+    }
+
+    void write(const FlightRecordKind kind,
+               const std::uint8_t vehicle_id,
+               const std::uint64_t time_point,
+               const std::byte* data,
+               const std::size_t size)
+    {
+        const std::size_t chunk_size = flightChunkSize(size);
+        if (!reserve(chunk_size)) {
+            return;
+        }
+
+        if (kind != FlightRecordKind::Index && time_point >= _next_index_time) {
+            _index.push_back(FlightIndexEntry{ time_point, _write_pos });
+            _next_index_time = time_point
+                               + static_cast<std::uint64_t>(
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(_settings.index_interval).count());
+        }
+
+        FlightChunkHeader header;
+        header.kind = kind;
+        header.vehicle_id = vehicle_id;
+        header.size = static_cast<std::uint32_t>(size);
+        header.time_point = time_point;
+        header.sequence = _sequence++;
+
+        std::byte* target = _view + (_write_pos - _view_offset);
+        std::memcpy(target, &header, sizeof(header));
+        if (size > 0) {
+            std::memcpy(target + sizeof(header), data, size);
+        }
+        const std::size_t padding = chunk_size - sizeof(header) - size;
+        if (padding > 0) {
+            std::memset(target + sizeof(header) + size, 0, padding);
+        }
+        _write_pos += chunk_size;
+    }
+
+    /// <summary>
+    /// Индекс в конец файла, заголовок, обрезка файла до конца данных
+    /// </summary>
+    void finish()
+    {
+        if (!_failed) {
+            const std::uint64_t index_offset = _write_pos;
+            const std::uint64_t record_count = _sequence;
+            write(FlightRecordKind::Index, 0, now(), reinterpret_cast<const std::byte*>(_index.data()),
+                  _index.size() * sizeof(FlightIndexEntry));
+            if (!_failed) {
+                _header.index_offset = index_offset;
+            }
+            _header.record_count = record_count;
+        }
+        _header.data_end = _write_pos;
+        _header.dropped_count = _dropped.load(std::memory_order_relaxed);
+
+        const std::uint64_t data_end = _write_pos;
+        if (_file.resize(data_end)) {
+            std::byte* view = _file.map(0, sizeof(FlightLogHeader));
+            if (view != nullptr) {
+                std::memcpy(view, &_header, sizeof(_header));
+            }
+        }
+        _view = nullptr;
+        _file.close();
+        std::cout << "Журнал полёта закрыт, записей: " << _header.record_count
+                  << ", отброшено: " << _header.dropped_count << '\n';
+    }
+};
+}
+
+#endif
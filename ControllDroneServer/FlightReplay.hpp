@@ -0,0 +1,408 @@
+#ifndef FLIGHT_REPLAY_HPP
+#define FLIGHT_REPLAY_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+#include "FlightLog.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Параметры воспроизведения журнала полёта
+/// </summary>
+struct ReplaySettings
+{
+    std::string path;
+    // Скорость: 1 - реальное время, 4 - вчетверо быстрее,
+    // 0 - как можно быстрее, каждый запрос получает следующую запись
+    double speed = 1.0;
+    // После конца записи воспроизведение начинается сначала
+    bool loop = true;
+};
+
+/// <summary>
+/// Журнал полёта, открытый для воспроизведения.
+/// Файл отображается в память целиком, записи не копируются;
+/// после открытия объект только читается и общий для всех потоков.
+/// </summary>
+class FlightLogPlayer
+{
+public:
+    static constexpr std::size_t SENSOR_COUNT = 4;
+
+    /// <summary>
+    /// Запись сенсора или кадра: время и данные после заголовка источника
+    /// </summary>
+    struct Sample
+    {
+        std::uint64_t time_point = 0;
+        const std::byte* data = nullptr;
+        std::size_t size = 0;
+    };
+
+private:
+    struct VehicleTrack
+    {
+        bool present = false;
+        std::array<std::vector<Sample>, SENSOR_COUNT> sensors;
+        std::array<std::vector<Sample>, CAMERA_COUNT> frames;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    ReplaySettings _settings;
+    MappedFile _file;
+    const std::byte* _data = nullptr;
+    std::array<VehicleTrack, 256> _tracks;
+    std::uint64_t _begin = 0;
+    std::uint64_t _end = 0;
+    Clock::time_point _started;
+
+public:
+    FlightLogPlayer() = default;
+    FlightLogPlayer(const FlightLogPlayer&) = delete;
+    FlightLogPlayer& operator=(const FlightLogPlayer&) = delete;
+
+    /// <summary>
+    /// Открытие журнала и построение списков записей по дронам, сенсорам и камерам
+    /// </summary>
+    bool open(const ReplaySettings& settings)
+    {
+        _settings = settings;
+        if (!_file.open(settings.path, false) || _file.size() < sizeof(FlightLogHeader)) {
+            std::cerr << "Ошибка открытия журнала полёта: " << settings.path << "\n";
+            return false;
+        }
+        _data = _file.map(0, static_cast<std::size_t>(_file.size()));
+        if (_data == nullptr) {
+            std::cerr << "Ошибка отображения журнала полёта в память\n";
+            return false;
+        }
+
+        FlightLogHeader header;
+        std::memcpy(&header, _data, sizeof(header));
+        if (std::memcmp(header.magic, FLIGHT_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != FLIGHT_LOG_VERSION) {
+            std::cerr << "Неверный формат журнала полёта: " << settings.path << "\n";
+            return false;
+        }
+
+        // Незакрытый журнал читается до первого повреждённого заголовка
+        const std::uint64_t data_end = header.data_end != 0 ? std::min<std::uint64_t>(header.data_end, _file.size()) : _file.size();
+        std::size_t records = 0;
+        std::uint64_t offset = header.header_size;
+        while (offset + sizeof(FlightChunkHeader) <= data_end) {
+            FlightChunkHeader chunk;
+            std::memcpy(&chunk, _data + offset, sizeof(chunk));
+            if (chunk.magic != FLIGHT_CHUNK_MAGIC || offset + sizeof(chunk) + chunk.size > data_end) {
+                break;
+            }
+            add(chunk, _data + offset + sizeof(chunk));
+            offset += flightChunkSize(chunk.size);
+            ++records;
+        }
+        if (_begin == 0) {
+            std::cerr << "В журнале полёта нет телеметрии и кадров: " << settings.path << "\n";
+            return false;
+        }
+
+        _started = Clock::now();
+        std::cout << "Воспроизведение журнала полёта: " << settings.path << ", записей: " << records
+                  << ", длительность: " << static_cast<double>(_end - _begin) / 1e9 << " с" << '\n';
+        return true;
+    }
+
+    /// <summary>
+    /// Имена дронов журнала, по порядку номеров
+    /// </summary>
+    std::vector<std::string> vehicleNames() const
+    {
+        std::vector<std::string> names;
+        for (std::size_t id = 0; id < _tracks.size(); ++id) {
+            if (_tracks[id].present) {
+                names.push_back("replay-" + std::to_string(id));
+            }
+        }
+        return names;
+    }
+
+    /// <summary>
+    /// Номер дрона в журнале по имени из vehicleNames(), пустое имя - первый дрон
+    /// </summary>
+    std::uint8_t vehicleId(const std::string& name) const
+    {
+        const std::string prefix = "replay-";
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            const unsigned long id = std::strtoul(name.c_str() + prefix.size(), nullptr, 10);
+            if (id < _tracks.size()) {
+                return static_cast<std::uint8_t>(id);
+            }
+        }
+        const std::vector<std::string> names = vehicleNames();
+        return names.empty() ? 0 : vehicleId(names.front());
+    }
+
+    /// <summary>
+    /// Запись сенсора на текущий момент воспроизведения
+    /// </summary>
+    /// <param name="cursor">Позиция вызывающего в режиме "как можно быстрее"</param>
+    const Sample* sensor(const std::uint8_t vehicle_id, const DroneSensors sensor, std::size_t& cursor) const
+    {
+        const std::size_t index = static_cast<std::size_t>(sensor);
+        if (index >= SENSOR_COUNT) {
+            return nullptr;
+        }
+        return select(_tracks[vehicle_id].sensors[index], cursor);
+    }
+
+    /// <summary>
+    /// Кадр камеры на текущий момент воспроизведения
+    /// </summary>
+    const Sample* frame(const std::uint8_t vehicle_id, const DroneCamera camera, std::size_t& cursor) const
+    {
+        return select(_tracks[vehicle_id].frames[static_cast<std::size_t>(camera)], cursor);
+    }
+
+private:
+    void add(const FlightChunkHeader& chunk, const std::byte* data)
+    {
+        if (chunk.kind == FlightRecordKind::Sensor && chunk.size >= sizeof(TelemetrySampleHeader)) {
+            TelemetrySampleHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            const std::size_t index = static_cast<std::size_t>(header.sensor);
+            if (index >= SENSOR_COUNT) {
+                return;
+            }
+            push(_tracks[header.vehicle_id].sensors[index], chunk, data + sizeof(header), chunk.size - sizeof(header));
+            _tracks[header.vehicle_id].present = true;
+        }
+        else if (chunk.kind == FlightRecordKind::Frame && chunk.size >= sizeof(ImageFrameHeader)) {
+            ImageFrameHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            const std::size_t camera = static_cast<std::size_t>(header.camera);
+            if (header.magic != IMAGE_FRAME_MAGIC || camera >= CAMERA_COUNT) {
+                return;
+            }
+            // Кадр хранится вместе с заголовком: из него берутся размер и кодирование
+            push(_tracks[header.vehicle_id].frames[camera], chunk, data, chunk.size);
+            _tracks[header.vehicle_id].present = true;
+        }
+    }
+
+    void push(std::vector<Sample>& samples, const FlightChunkHeader& chunk, const std::byte* data, const std::size_t size)
+    {
+        samples.push_back(Sample{ chunk.time_point, data, size });
+        if (_begin == 0 || chunk.time_point < _begin) {
+            _begin = chunk.time_point;
+        }
+        _end = std::max(_end, chunk.time_point);
+    }
+
+    /// <summary>
+    /// Время журнала, соответствующее текущему моменту воспроизведения
+    /// </summary>
+    std::uint64_t logTime() const
+    {
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - _started).count() * _settings.speed;
+        std::uint64_t offset = static_cast<std::uint64_t>(elapsed);
+        const std::uint64_t duration = _end - _begin;
+        if (_settings.loop) {
+            offset %= duration + 1;
+        }
+        else {
+            offset = std::min(offset, duration);
+        }
+        return _begin + offset;
+    }
+
+    const Sample* select(const std::vector<Sample>& samples, std::size_t& cursor) const
+    {
+        if (samples.empty()) {
+            return nullptr;
+        }
+        if (_settings.speed <= 0.0) {
+            if (cursor >= samples.size()) {
+                if (!_settings.loop) {
+                    return &samples.back();
+                }
+                cursor = 0;
+            }
+            return &samples[cursor++];
+        }
+
+        const std::uint64_t time_point = logTime();
+        auto it = std::upper_bound(samples.begin(), samples.end(), time_point,
+                                   [](const std::uint64_t value, const Sample& sample) { return value < sample.time_point; });
+        if (it == samples.begin()) {
+            return &samples.front();
+        }
+        return &*(it - 1);
+    }
+};
+
+/// <summary>
+/// Источник данных из журнала полёта вместо AirSim.
+/// Сенсоры и кадры берутся из записи, команды сразу считаются выполненными.
+/// Время в показаниях и кадрах заменяется текущим, чтобы задержки
+/// на стороне клиента считались так же, как с симулятором.
+/// </summary>
+class ReplayBackend : public DroneBackend
+{
+private:
+    std::shared_ptr<const FlightLogPlayer> _player;
+    std::string _vehicle_name;
+    std::uint8_t _track;
+    std::array<std::size_t, FlightLogPlayer::SENSOR_COUNT> _sensor_cursors{};
+    std::array<std::size_t, CAMERA_COUNT> _frame_cursors{};
+
+public:
+    ReplayBackend(std::shared_ptr<const FlightLogPlayer> player, const std::string& vehicle_name)
+        : _player(std::move(player)),
+          _vehicle_name(vehicle_name),
+          _track(_player->vehicleId(vehicle_name))
+    {
+    }
+
+    const std::string& vehicleName() const override
+    {
+        return _vehicle_name;
+    }
+
+    std::vector<std::string> listVehicles() override
+    {
+        return _player->vehicleNames();
+    }
+
+    void connection() override {}
+    void armDisarm(bool arm = true) override { (void)arm; }
+    void setParams(const DroneMethodReq& request) override { (void)request; }
+    double takeoff(const float takeoff_timeout = 5) override { (void)takeoff_timeout; return 0.0; }
+    void landing() override {}
+    void enableApiControl() override {}
+    void velocityBodyFrame(const float, const float, const float, const float, const float) override {}
+    Vector3r position() override { return Vector3r(0, 0, 0); }
+    bool landed() override { return true; }
+    void moveToPosition(const Vector3r&, const float, const DrivetrainType, const YawMode&) override {}
+    void hover() override {}
+    void cancel() override {}
+    double testFlyBoxLeg(const std::size_t, const float = 3.0f, const float = 10.0f) override { return 0.0; }
+    double toUpFly() override { return 0.0; }
+    double toDownFly() override { return 0.0; }
+    double toForwardFly() override { return 0.0; }
+    double toRightFly() override { return 0.0; }
+    double toLeftFly() override { return 0.0; }
+    double toBackFly() override { return 0.0; }
+    double rotateByYaw(bool left = true) override { (void)left; return 0.0; }
+
+    BarometerSensorDataRep barometerData() override
+    {
+        return sample<BarometerSensorDataRep>(DroneSensors::Barometer);
+    }
+
+    ImuSensorDataRep imuData() override
+    {
+        return sample<ImuSensorDataRep>(DroneSensors::Imu);
+    }
+
+    GpsSensorDataRep gpsData() override
+    {
+        return sample<GpsSensorDataRep>(DroneSensors::Gps);
+    }
+
+    MagnetometerSensorDataRep magnetometerData() override
+    {
+        return sample<MagnetometerSensorDataRep>(DroneSensors::Magnetometer);
+    }
+
+    std::vector<CameraFrame> cameraFrames(const std::vector<DroneCamera>& cameras, const bool compress = true) override
+    {
+        (void)compress;
+        std::vector<CameraFrame> frames;
+        frames.reserve(cameras.size());
+        for (const DroneCamera camera : cameras) {
+            CameraFrame frame;
+            frame.camera = camera;
+            const FlightLogPlayer::Sample* recorded =
+                _player->frame(_track, camera, _frame_cursors[static_cast<std::size_t>(camera)]);
+            if (recorded != nullptr) {
+                ImageFrameHeader header;
+                std::memcpy(&header, recorded->data, sizeof(header));
+                const std::size_t header_size = std::min<std::size_t>(std::max<std::size_t>(header.header_size, sizeof(header)), recorded->size);
+                frame.time_stamp = now();
+                frame.width = header.width;
+                frame.height = header.height;
+                frame.encoding = header.encoding;
+                std::copy(std::begin(header.position), std::end(header.position), frame.position);
+                std::copy(std::begin(header.orientation), std::end(header.orientation), frame.orientation);
+                const auto* bytes = reinterpret_cast<const std::uint8_t*>(recorded->data + header_size);
+                frame.bytes.assign(bytes, bytes + (recorded->size - header_size));
+            }
+            frames.push_back(std::move(frame));
+        }
+        return frames;
+    }
+
+    CameraInfo cameraInfo(const std::string& camera_name) override
+    {
+        (void)camera_name;
+        return CameraInfo();
+    }
+
+    /// <summary>
+    /// Глубина не записывается в журнал
+    /// </summary>
+    std::vector<ImageResponse> cameraPixelsDepth(const std::string& camera_name_val) override
+    {
+        (void)camera_name_val;
+        return {};
+    }
+
+private:
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    template <typename Rep>
+    Rep sample(const DroneSensors sensor)
+    {
+        Rep data{};
+        const FlightLogPlayer::Sample* recorded =
+            _player->sensor(_track, sensor, _sensor_cursors[static_cast<std::size_t>(sensor)]);
+        if (recorded != nullptr && recorded->size >= sizeof(Rep)) {
+            std::memcpy(&data, recorded->data, sizeof(Rep));
+        }
+        data.time_point = now();
+        return data;
+    }
+};
+
+/// <summary>
+/// Фабрика источников воспроизведения для реестра дронов
+/// </summary>
+/// <returns>Пустая фабрика, если журнал не открыт</returns>
+inline DroneBackendFactory makeReplayBackendFactory(const ReplaySettings& settings)
+{
+    auto player = std::make_shared<FlightLogPlayer>();
+    if (!player->open(settings)) {
+        return {};
+    }
+    return [player](const std::string& vehicle_name) -> std::unique_ptr<DroneBackend> {
+        return std::make_unique<ReplayBackend>(player, vehicle_name);
+    };
+}
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef FRAME_ENCODER_HPP
+#define FRAME_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <lz4.h>
+#include <turbojpeg.h>
+
+#include "AsyncLog.hpp"
+#include "DroneRpc.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Настройки кодирования кадров камеры
+/// </summary>
+struct FrameEncoderSettings
+{
+    // Кодирование кадров по умолчанию, клиент может выбрать другое в запросе
+    ImageEncoding encoding = ImageEncoding::Jpeg;
+    // Качество JPEG, 1..100
+    int jpeg_quality = 80;
+    // Ускорение LZ4: больше - быстрее и хуже сжатие
+    int lz4_acceleration = 1;
+};
+
+/// <summary>
+/// Кодирование несжатых кадров AirSim в JPEG через libjpeg-turbo (SIMD)
+/// или в LZ4 для передачи по локальной сети без потерь.
+/// Дескриптор TurboJPEG не потокобезопасен, поэтому у каждого потока
+/// захвата свой кодировщик.
+/// </summary>
+class FrameEncoder
+{
+private:
+    FrameEncoderSettings _settings;
+    tjhandle _handle = nullptr;
+    // Буфер результата, растёт до наибольшего кадра и переиспользуется
+    std::vector<std::uint8_t> _scratch;
+
+public:
+    explicit FrameEncoder(const FrameEncoderSettings& settings)
+        : _settings(settings)
+    {
+    }
+
+    ~FrameEncoder()
+    {
+        if (_handle != nullptr) {
+            tjDestroy(_handle);
+        }
+    }
+
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    /// <summary>
+    /// Нужно ли запрашивать у AirSim сжатый PNG
+    /// </summary>
+    static bool requestCompressed(const ImageEncoding target)
+    {
+        return target == ImageEncoding::Png;
+    }
+
+    /// <summary>
+    /// Кодирование кадра на месте
+    /// </summary>
+    /// <param name="encoding">Кодирование полученных от AirSim данных</param>
+    /// <param name="target">Требуемое кодирование</param>
+    /// <param name="bytes">Данные изображения, заменяются результатом</param>
+    /// <returns>Кодирование результата</returns>
+    ImageEncoding encode(const ImageEncoding encoding,
+                         const ImageEncoding target,
+                         const std::uint32_t width,
+                         const std::uint32_t height,
+                         std::vector<std::uint8_t>& bytes)
+    {
+        if (encoding != ImageEncoding::Bgr8 || target == encoding) {
+            return encoding;
+        }
+
+        const std::size_t pixels = static_cast<std::size_t>(width) * height;
+        if (pixels == 0 || bytes.size() != pixels * 3) {
+            DRONE_LOG_WARN("Неожиданный размер несжатого кадра: {}", bytes.size());
+            return encoding;
+        }
+
+        switch (target) {
+        case ImageEncoding::Jpeg:
+            return encodeJpeg(width, height, bytes) ? ImageEncoding::Jpeg : encoding;
+        case ImageEncoding::Lz4Bgr:
+            return encodeLz4(bytes) ? ImageEncoding::Lz4Bgr : encoding;
+        default:
+            return encoding;
+        }
+    }
+
+private:
+    bool encodeJpeg(const std::uint32_t width, const std::uint32_t height, std::vector<std::uint8_t>& bytes)
+    {
+        if (_handle == nullptr) {
+            _handle = tjInitCompress();
+            if (_handle == nullptr) {
+                DRONE_LOG_ERROR("Ошибка инициализации кодировщика JPEG");
+                return false;
+            }
+        }
+
+        // Кодирование в общий буфер под максимальный размер JPEG, без перевыделения
+        reserveScratch(tjBufSize(static_cast<int>(width), static_cast<int>(height), TJSAMP_420));
+        unsigned char* jpeg_data = _scratch.data();
+        unsigned long jpeg_size = static_cast<unsigned long>(_scratch.size());
+        if (tjCompress2(_handle, bytes.data(), static_cast<int>(width), 0, static_cast<int>(height), TJPF_BGR,
+                        &jpeg_data, &jpeg_size, TJSAMP_420, _settings.jpeg_quality,
+                        TJFLAG_FASTDCT | TJFLAG_NOREALLOC) < 0) {
+            DRONE_LOG_ERROR("Ошибка кодирования JPEG: {}", tjGetErrorStr2(_handle));
+            return false;
+        }
+
+        // Результат копируется в память исходного кадра, она не меньше сжатого
+        bytes.assign(_scratch.begin(), _scratch.begin() + static_cast<std::ptrdiff_t>(jpeg_size));
+        return true;
+    }
+
+    bool encodeLz4(std::vector<std::uint8_t>& bytes)
+    {
+        const int src_size = static_cast<int>(bytes.size());
+        reserveScratch(static_cast<std::size_t>(LZ4_compressBound(src_size)));
+        const int lz4_size = LZ4_compress_fast(reinterpret_cast<const char*>(bytes.data()),
+                                               reinterpret_cast<char*>(_scratch.data()),
+                                               src_size,
+                                               static_cast<int>(_scratch.size()),
+                                               _settings.lz4_acceleration);
+        if (lz4_size <= 0) {
+            DRONE_LOG_ERROR("Ошибка сжатия кадра LZ4");
+            return false;
+        }
+
+        bytes.assign(_scratch.begin(), _scratch.begin() + lz4_size);
+        return true;
+    }
+
+    /// <summary>
+    /// Увеличение буфера результата, если кадр больше всех предыдущих
+    /// </summary>
+    void reserveScratch(const std::size_t size)
+    {
+        if (_scratch.size() < size) {
+            _scratch.resize(size);
+        }
+    }
+};
+}
+
+#endif
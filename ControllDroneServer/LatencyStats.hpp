@@ -0,0 +1,253 @@
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DroneRpc.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Гистограмма задержек в микросекундах с логарифмически-линейными корзинами
+/// (как HDR Histogram): до 16 мкс корзина на каждое значение, дальше
+/// 16 корзин на каждую степень двойки, относительная погрешность не больше 1/16.
+/// Запись без блокировок и выделения памяти, из любого числа потоков.
+/// </summary>
+class LatencyHistogram
+{
+public:
+    static constexpr std::uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr std::uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    // Значения больше 2^32 мкс (больше часа) попадают в последнюю корзину
+    static constexpr std::uint32_t VALUE_BITS = 32;
+    static constexpr std::size_t BUCKET_COUNT = SUB_BUCKETS + (VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> _buckets{};
+    std::atomic<std::uint64_t> _count{ 0 };
+    std::atomic<std::uint64_t> _max{ 0 };
+
+public:
+    /// <summary>
+    /// Учёт одного значения
+    /// </summary>
+    void record(const std::uint64_t micros)
+    {
+        _buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t max = _max.load(std::memory_order_relaxed);
+        while (micros > max && !_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::uint64_t count() const
+    {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max() const
+    {
+        return _max.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Значение, не превышаемое долей quantile всех значений (середина корзины)
+    /// </summary>
+    /// <param name="quantile">0..1</param>
+    std::uint64_t percentile(const double quantile) const
+    {
+        // Счётчики читаются без общей блокировки, поэтому ранг считается
+        // по сумме корзин, а не по _count, который мог уйти вперёд
+        std::uint64_t total = 0;
+        for (const std::atomic<std::uint64_t>& bucket : _buckets) {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+        const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(clamped * static_cast<double>(total) + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += _buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(bucketMiddle(i), max());
+            }
+        }
+        return max();
+    }
+
+    /// <summary>
+    /// Номер корзины значения
+    /// </summary>
+    static std::size_t bucketIndex(std::uint64_t micros)
+    {
+        if (micros < SUB_BUCKETS) {
+            return static_cast<std::size_t>(micros);
+        }
+        if (micros >> VALUE_BITS) {
+            return BUCKET_COUNT - 1;
+        }
+        std::uint32_t msb = SUB_BUCKET_BITS;
+        while (micros >> (msb + 1)) {
+            ++msb;
+        }
+        const std::uint32_t shift = msb - SUB_BUCKET_BITS;
+        const std::size_t sub = static_cast<std::size_t>((micros >> shift) & (SUB_BUCKETS - 1));
+        return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+    }
+
+    /// <summary>
+    /// Середина диапазона значений корзины
+    /// </summary>
+    static std::uint64_t bucketMiddle(const std::size_t index)
+    {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const std::size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+        const std::uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+        const std::uint64_t lower = (SUB_BUCKETS + sub) << shift;
+        const std::uint64_t width = std::uint64_t(1) << shift;
+        return lower + (width - 1) / 2;
+    }
+};
+
+/// <summary>
+/// Задержки сервера по этапам: для каждой команды от приёма до отправки ответа,
+/// для каждой камеры от запроса кадра до отправки клиенту.
+/// Все гистограммы выделяются при создании, запись без блокировок.
+/// </summary>
+class ServerStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Этапы камер - FrameCapture и FrameSend, остальные - этапы команд
+    static constexpr std::size_t CAMERA_STAGES = 2;
+    static constexpr std::size_t METHOD_STAGES = LATENCY_STAGE_COUNT - CAMERA_STAGES;
+
+private:
+    std::unique_ptr<LatencyHistogram[]> _methods;
+    std::unique_ptr<LatencyHistogram[]> _cameras;
+
+public:
+    ServerStats()
+        : _methods(std::make_unique<LatencyHistogram[]>(DRONE_METHOD_COUNT * METHOD_STAGES)),
+          _cameras(std::make_unique<LatencyHistogram[]>(CAMERA_COUNT * CAMERA_STAGES))
+    {
+    }
+
+    ServerStats(const ServerStats&) = delete;
+    ServerStats& operator=(const ServerStats&) = delete;
+
+    /// <summary>
+    /// Учёт задержки этапа команды
+    /// </summary>
+    void recordMethod(const DroneMethods method, const LatencyStage stage, const Clock::duration elapsed)
+    {
+        const std::size_t m = static_cast<std::size_t>(method);
+        const std::size_t s = static_cast<std::size_t>(stage);
+        if (m < DRONE_METHOD_COUNT && s < LATENCY_STAGE_COUNT && !isCameraStage(s)) {
+            _methods[m * METHOD_STAGES + methodSlot(s)].record(toMicros(elapsed));
+        }
+    }
+
+    /// <summary>
+    /// Учёт задержки этапа камеры
+    /// </summary>
+    void recordCamera(const DroneCamera camera, const LatencyStage stage, const Clock::duration elapsed)
+    {
+        const std::size_t c = static_cast<std::size_t>(camera);
+        const std::size_t s = static_cast<std::size_t>(stage);
+        if (c < CAMERA_COUNT && isCameraStage(s)) {
+            _cameras[c * CAMERA_STAGES + cameraSlot(s)].record(toMicros(elapsed));
+        }
+    }
+
+    /// <summary>
+    /// Текущие p50/p99/max всех гистограмм, в которых есть значения
+    /// </summary>
+    std::vector<LatencyStatsRep> snapshot() const
+    {
+        std::vector<LatencyStatsRep> entries;
+        for (std::size_t m = 0; m < DRONE_METHOD_COUNT; ++m) {
+            for (std::size_t s = 0; s < LATENCY_STAGE_COUNT; ++s) {
+                if (!isCameraStage(s)) {
+                    append(entries, _methods[m * METHOD_STAGES + methodSlot(s)], LatencySource::Method, m, s);
+                }
+            }
+        }
+        for (std::size_t c = 0; c < CAMERA_COUNT; ++c) {
+            for (std::size_t s = 0; s < LATENCY_STAGE_COUNT; ++s) {
+                if (isCameraStage(s)) {
+                    append(entries, _cameras[c * CAMERA_STAGES + cameraSlot(s)], LatencySource::Camera, c, s);
+                }
+            }
+        }
+        return entries;
+    }
+
+    static std::uint64_t toMicros(const Clock::duration elapsed)
+    {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        return micros > 0 ? static_cast<std::uint64_t>(micros) : 0;
+    }
+
+private:
+    static constexpr std::size_t FIRST_CAMERA_STAGE = static_cast<std::size_t>(LatencyStage::FrameCapture);
+
+    static constexpr bool isCameraStage(const std::size_t stage)
+    {
+        return stage >= FIRST_CAMERA_STAGE && stage < FIRST_CAMERA_STAGE + CAMERA_STAGES;
+    }
+
+    /// <summary>
+    /// Номер гистограммы этапа команды: этапы камер пропускаются
+    /// </summary>
+    static constexpr std::size_t methodSlot(const std::size_t stage)
+    {
+        return stage < FIRST_CAMERA_STAGE ? stage : stage - CAMERA_STAGES;
+    }
+
+    static constexpr std::size_t cameraSlot(const std::size_t stage)
+    {
+        return stage - FIRST_CAMERA_STAGE;
+    }
+
+    static void append(std::vector<LatencyStatsRep>& entries,
+                       const LatencyHistogram& histogram,
+                       const LatencySource source,
+                       const std::size_t id,
+                       const std::size_t stage)
+    {
+        if (histogram.count() == 0) {
+            return;
+        }
+        LatencyStatsRep entry;
+        entry.source = source;
+        entry.id = static_cast<std::uint8_t>(id);
+        entry.stage = static_cast<LatencyStage>(stage);
+        entry.count = histogram.count();
+        entry.p50_us = saturate(histogram.percentile(0.50));
+        entry.p99_us = saturate(histogram.percentile(0.99));
+        entry.max_us = saturate(histogram.max());
+        entries.push_back(entry);
+    }
+
+    static std::uint32_t saturate(const std::uint64_t value)
+    {
+        return static_cast<std::uint32_t>(std::min<std::uint64_t>(value, UINT32_MAX));
+    }
+};
+}
+
+#endif
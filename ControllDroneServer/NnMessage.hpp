@@ -0,0 +1,78 @@
+#ifndef NN_MESSAGE_HPP
+#define NN_MESSAGE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include <compat/nanomsg/nn.h>
+
+namespace drone
+{
+/// <summary>
+/// Сообщение nanomsg, принятое без копирования (NN_MSG).
+/// Владение буфером разделяемое, буфер освобождается через nn_freemsg
+/// после уничтожения последней копии.
+/// </summary>
+class NnMessage
+{
+private:
+    std::shared_ptr<std::byte> _data;
+    std::size_t _size = 0;
+
+    NnMessage(void* buffer, std::size_t size)
+        : _data(static_cast<std::byte*>(buffer), [](std::byte* ptr) { nn_freemsg(ptr); }),
+          _size(size)
+    {
+    }
+
+public:
+    NnMessage() = default;
+
+    /// <summary>
+    /// Приём сообщения из сокета, размер буфера равен размеру посылки
+    /// </summary>
+    /// <param name="sock_fd">Сокет nanomsg</param>
+    /// <param name="flags">Флаги nn_recv</param>
+    /// <returns>Пусто при ошибке приёма (код в nn_errno)</returns>
+    static std::optional<NnMessage> receive(int sock_fd, int flags = 0)
+    {
+        void* buffer = nullptr;
+        const int bytes_received = nn_recv(sock_fd, &buffer, NN_MSG, flags);
+        if (bytes_received < 0) {
+            return std::nullopt;
+        }
+        return NnMessage(buffer, static_cast<std::size_t>(bytes_received));
+    }
+
+    const std::byte* data() const
+    {
+        return _data.get();
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    /// <summary>
+    /// Интерпретация начала сообщения как структуры
+    /// </summary>
+    /// <returns>nullptr, если сообщение короче структуры</returns>
+    template <typename T>
+    const T* as() const
+    {
+        if (_size < sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(_data.get());
+    }
+};
+}
+
+#endif
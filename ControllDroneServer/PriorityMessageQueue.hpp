@@ -0,0 +1,140 @@
+#ifndef PRIORITY_MSG_QUEUE_HPP
+#define PRIORITY_MSG_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "RingMessageQueue.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Очередь сообщений с классами приоритета (MPSC, в т.ч. MPMC).
+/// Каждый класс - отдельная кольцевая очередь своей ёмкости, поэтому
+/// переполнение младшего класса не задерживает постановку старшего.
+/// Извлекается сообщение старшего непустого класса, внутри класса - FIFO.
+/// </summary>
+template <typename MessageType, std::size_t LaneCount>
+class PriorityMessageQueue
+{
+    static_assert(LaneCount > 0, "PriorityMessageQueue needs at least one lane");
+
+private:
+    using Lane = RingMessageQueue<MessageType>;
+
+    std::array<std::unique_ptr<Lane>, LaneCount> _lanes;
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> _closed{ false };
+    SpinThenBlockWait _not_empty;
+
+public:
+    /// <summary>
+    /// Создание очереди
+    /// </summary>
+    /// <param name="lane_capacity">Максимальное число сообщений одного класса</param>
+    /// <param name="spin_limit">Число итераций активного ожидания до блокировки</param>
+    explicit PriorityMessageQueue(std::size_t lane_capacity = 1024, std::uint32_t spin_limit = 1024)
+        : _not_empty(spin_limit)
+    {
+        for (std::unique_ptr<Lane>& lane : _lanes) {
+            lane = std::make_unique<Lane>(lane_capacity, spin_limit);
+        }
+    }
+
+    PriorityMessageQueue(const PriorityMessageQueue&) = delete;
+    PriorityMessageQueue& operator=(const PriorityMessageQueue&) = delete;
+
+    /// <summary>
+    /// Добавление сообщения с ожиданием свободного места в его классе
+    /// </summary>
+    /// <param name="lane">Класс приоритета, больше - старше</param>
+    /// <returns>false, если очередь закрыта</returns>
+    bool push(MessageType&& message, const std::size_t lane)
+    {
+        if (!_lanes[clampLane(lane)]->push(std::move(message))) {
+            return false;
+        }
+        _not_empty.notify();
+        return true;
+    }
+
+    /// <summary>
+    /// Добавление сообщения без ожидания
+    /// </summary>
+    /// <returns>false, если класс заполнен или очередь закрыта</returns>
+    bool try_push(MessageType&& message, const std::size_t lane)
+    {
+        if (!_lanes[clampLane(lane)]->try_push(std::move(message))) {
+            return false;
+        }
+        _not_empty.notify();
+        return true;
+    }
+
+    /// <summary>
+    /// Извлечение сообщения старшего класса без ожидания
+    /// </summary>
+    std::optional<MessageType> try_pop()
+    {
+        for (std::size_t i = LaneCount; i-- > 0;) {
+            if (std::optional<MessageType> message = _lanes[i]->try_pop()) {
+                return message;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// <summary>
+    /// Извлечение сообщения старшего класса с ожиданием
+    /// </summary>
+    /// <returns>Пусто, если очередь закрыта и все сообщения выбраны</returns>
+    std::optional<MessageType> pop()
+    {
+        std::optional<MessageType> result;
+        _not_empty.wait([&]() {
+            result = try_pop();
+            return result.has_value() || _closed.load(std::memory_order_acquire);
+        });
+        if (!result) {
+            result = try_pop();
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// Закрытие очереди: новые сообщения не принимаются, ожидающие потоки пробуждаются
+    /// </summary>
+    void close()
+    {
+        _closed.store(true, std::memory_order_release);
+        for (std::unique_ptr<Lane>& lane : _lanes) {
+            lane->close();
+        }
+        _not_empty.notifyAll();
+    }
+
+    bool closed() const
+    {
+        return _closed.load(std::memory_order_acquire);
+    }
+
+    /// <summary>
+    /// Приблизительное число сообщений класса
+    /// </summary>
+    std::size_t size(const std::size_t lane) const
+    {
+        return _lanes[clampLane(lane)]->size();
+    }
+
+private:
+    static std::size_t clampLane(const std::size_t lane)
+    {
+        return lane < LaneCount ? lane : LaneCount - 1;
+    }
+};
+}
+
+#endif
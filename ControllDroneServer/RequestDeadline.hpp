@@ -0,0 +1,124 @@
+#ifndef REQUEST_DEADLINE_HPP
+#define REQUEST_DEADLINE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+namespace drone
+{
+/// <summary>
+/// Возраст запроса по монотонным часам клиента.
+/// Часы клиента и сервера не синхронизированы, поэтому их смещение
+/// оценивается как наименьшая разница "приём на сервере - отметка клиента"
+/// за два последних окна: самый быстрый запрос считается пришедшим без
+/// задержки, возраст остальных отсчитывается от него. Окно ограничивает
+/// влияние ухода часов.
+/// nanomsg не сообщает адрес отправителя, поэтому часы ведутся для сокета,
+/// номера запуска клиента и дрона: перезапущенный клиент получает новую
+/// оценку. Клиенты без номера запуска делят одну оценку на сокет и дрон.
+/// Оценки клиентов, не присылавших запросов дольше idle_timeout, удаляются.
+/// Вызывается только из цикла сообщений, без блокировок.
+/// </summary>
+class RequestAgeEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct ClientClock
+    {
+        std::int64_t current_min = 0;  // наименьшее смещение в текущем окне, мкс
+        std::int64_t previous_min = 0; // в предыдущем окне
+        Clock::time_point window_start{};
+        Clock::time_point last_seen{};
+    };
+
+    // Сокет, номер запуска клиента и дрон
+    using ClientKey = std::tuple<int, std::uint64_t, std::uint8_t>;
+
+    Clock::duration _window;
+    Clock::duration _idle_timeout;
+    std::map<ClientKey, ClientClock> _clocks;
+    Clock::time_point _pruned{};
+
+public:
+    explicit RequestAgeEstimator(const Clock::duration window = std::chrono::seconds(5),
+                                 const Clock::duration idle_timeout = std::chrono::minutes(1))
+        : _window(window),
+          _idle_timeout(idle_timeout)
+    {
+    }
+
+    /// <summary>
+    /// Учёт отметки запроса и его возраст к моменту разбора
+    /// </summary>
+    /// <param name="client_session">Номер запуска клиента, 0 - не задан</param>
+    /// <param name="client_time_us">Монотонное время клиента при создании запроса, мкс</param>
+    /// <param name="received">Приём запроса сервером</param>
+    /// <param name="now">Разбор запроса</param>
+    Clock::duration age(const int sock,
+                        const std::uint64_t client_session,
+                        const std::uint8_t vehicle_id,
+                        const std::uint64_t client_time_us,
+                        const Clock::time_point received,
+                        const Clock::time_point now)
+    {
+        prune(received);
+        const std::int64_t offset = toMicros(received) - static_cast<std::int64_t>(client_time_us);
+
+        const auto [it, inserted] = _clocks.try_emplace(ClientKey(sock, client_session, vehicle_id));
+        ClientClock& clock = it->second;
+        clock.last_seen = received;
+        if (inserted) {
+            clock.current_min = offset;
+            clock.previous_min = offset;
+            clock.window_start = received;
+        }
+        else if (received - clock.window_start >= _window) {
+            clock.previous_min = clock.current_min;
+            clock.current_min = offset;
+            clock.window_start = received;
+        }
+        else if (offset < clock.current_min) {
+            clock.current_min = offset;
+        }
+
+        const auto in_transit = std::chrono::microseconds(offset - baseline(clock));
+        return std::chrono::duration_cast<Clock::duration>(in_transit) + (now - received);
+    }
+
+private:
+    /// <summary>
+    /// Удаление оценок ушедших клиентов, не чаще раза за окно
+    /// </summary>
+    void prune(const Clock::time_point now)
+    {
+        if (now - _pruned < _window) {
+            return;
+        }
+        _pruned = now;
+        for (auto it = _clocks.begin(); it != _clocks.end();) {
+            if (now - it->second.last_seen > _idle_timeout) {
+                it = _clocks.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    static std::int64_t baseline(const ClientClock& clock)
+    {
+        return clock.current_min < clock.previous_min ? clock.current_min : clock.previous_min;
+    }
+
+    static std::int64_t toMicros(const Clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+};
+}
+
+#endif
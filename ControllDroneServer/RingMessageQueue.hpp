@@ -0,0 +1,342 @@
+#ifndef RING_MSG_QUEUE_HPP
+#define RING_MSG_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace drone
+{
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/// <summary>
+/// Стратегия ожидания: только активное ожидание с уступкой процессора
+/// </summary>
+class SpinWait
+{
+public:
+    explicit SpinWait(std::uint32_t /*spin_limit*/ = 0) {}
+
+    template <typename Predicate>
+    void wait(Predicate ready)
+    {
+        while (!ready()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void notify() {}
+    void notifyAll() {}
+};
+
+/// <summary>
+/// Стратегия ожидания: активное ожидание заданное число итераций,
+/// затем блокировка на условной переменной
+/// </summary>
+class SpinThenBlockWait
+{
+private:
+    std::uint32_t _spin_limit;
+    std::atomic<std::uint32_t> _waiters{ 0 };
+    std::mutex _mtx;
+    std::condition_variable _cond_var;
+
+public:
+    explicit SpinThenBlockWait(std::uint32_t spin_limit = 1024)
+        : _spin_limit(spin_limit)
+    {
+    }
+
+    /// <summary>
+    /// Ожидание выполнения условия
+    /// </summary>
+    template <typename Predicate>
+    void wait(Predicate ready)
+    {
+        for (std::uint32_t i = 0; i < _spin_limit; ++i) {
+            if (ready()) {
+                return;
+            }
+            if ((i & 0x3f) == 0x3f) {
+                std::this_thread::yield();
+            }
+        }
+
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cond_var.wait(lock, ready);
+        }
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Пробуждение одного ожидающего потока (только если он заблокирован)
+    /// </summary>
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _cond_var.notify_one();
+        }
+    }
+
+    /// <summary>
+    /// Пробуждение всех ожидающих потоков
+    /// </summary>
+    void notifyAll()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lock(_mtx);
+        _cond_var.notify_all();
+    }
+};
+
+/// <summary>
+/// Ограниченная неблокирующая кольцевая очередь сообщений (MPMC, в т.ч. SPSC/MPSC).
+/// Сообщения только перемещаются, ёмкость округляется до степени двойки.
+/// </summary>
+template <typename MessageType, typename WaitStrategy = SpinThenBlockWait>
+class RingMessageQueue
+{
+    static_assert(std::is_nothrow_move_constructible<MessageType>::value,
+                  "MessageType must be nothrow move constructible");
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        alignas(MessageType) unsigned char storage[sizeof(MessageType)];
+
+        MessageType* message()
+        {
+            return std::launder(reinterpret_cast<MessageType*>(storage));
+        }
+    };
+
+    Cell* _cells = nullptr;
+    std::size_t _mask = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _enqueue_pos{ 0 };
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _dequeue_pos{ 0 };
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> _closed{ false };
+    WaitStrategy _not_empty;
+    WaitStrategy _not_full;
+
+public:
+    /// <summary>
+    /// Создание очереди
+    /// </summary>
+    /// <param name="capacity">Максимальное число сообщений в очереди</param>
+    /// <param name="spin_limit">Число итераций активного ожидания до блокировки</param>
+    explicit RingMessageQueue(std::size_t capacity = 1024, std::uint32_t spin_limit = 1024)
+        : _not_empty(spin_limit),
+          _not_full(spin_limit)
+    {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+        _cells = new Cell[size];
+        for (std::size_t i = 0; i < size; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RingMessageQueue()
+    {
+        while (try_pop()) {
+        }
+        delete[] _cells;
+    }
+
+    RingMessageQueue(const RingMessageQueue&) = delete;
+    RingMessageQueue& operator=(const RingMessageQueue&) = delete;
+
+    /// <summary>
+    /// Добавление сообщения без ожидания
+    /// </summary>
+    /// <returns>false, если очередь заполнена или закрыта</returns>
+    bool try_push(MessageType&& message)
+    {
+        if (_closed.load(std::memory_order_acquire) || !enqueue(message)) {
+            return false;
+        }
+        _not_empty.notify();
+        return true;
+    }
+
+    /// <summary>
+    /// Добавление сообщения с ожиданием свободного места
+    /// </summary>
+    /// <returns>false, если очередь закрыта</returns>
+    bool push(MessageType&& message)
+    {
+        bool pushed = false;
+        _not_full.wait([&]() {
+            if (_closed.load(std::memory_order_acquire)) {
+                return true;
+            }
+            pushed = enqueue(message);
+            return pushed;
+        });
+        if (pushed) {
+            _not_empty.notify();
+        }
+        return pushed;
+    }
+
+    /// <summary>
+    /// Извлечение сообщения без ожидания
+    /// </summary>
+    std::optional<MessageType> try_pop()
+    {
+        std::optional<MessageType> result = dequeue();
+        if (result) {
+            _not_full.notify();
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// Извлечение сообщения с ожиданием
+    /// </summary>
+    /// <returns>Пусто, если очередь закрыта и все сообщения выбраны</returns>
+    std::optional<MessageType> pop()
+    {
+        std::optional<MessageType> result;
+        _not_empty.wait([&]() {
+            result = dequeue();
+            return result.has_value() || _closed.load(std::memory_order_acquire);
+        });
+        if (!result) {
+            result = dequeue();
+        }
+        if (result) {
+            _not_full.notify();
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// Извлечение пачки сообщений: ожидание первого, затем выбор без ожидания
+    /// </summary>
+    /// <param name="out">Итератор вывода</param>
+    /// <param name="max_count">Максимальное число извлекаемых сообщений</param>
+    /// <returns>Число извлечённых сообщений, 0 - очередь закрыта</returns>
+    template <typename OutputIt>
+    std::size_t pop_batch(OutputIt out, std::size_t max_count)
+    {
+        if (max_count == 0) {
+            return 0;
+        }
+        std::optional<MessageType> first = pop();
+        if (!first) {
+            return 0;
+        }
+        *out++ = std::move(*first);
+
+        std::size_t count = 1;
+        while (count < max_count) {
+            std::optional<MessageType> next = dequeue();
+            if (!next) {
+                break;
+            }
+            *out++ = std::move(*next);
+            ++count;
+        }
+        _not_full.notify();
+        return count;
+    }
+
+    /// <summary>
+    /// Закрытие очереди: новые сообщения не принимаются, ожидающие потоки пробуждаются
+    /// </summary>
+    void close()
+    {
+        _closed.store(true, std::memory_order_release);
+        _not_empty.notifyAll();
+        _not_full.notifyAll();
+    }
+
+    bool closed() const
+    {
+        return _closed.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+    /// <summary>
+    /// Приблизительное число сообщений в очереди
+    /// </summary>
+    std::size_t size() const
+    {
+        const std::size_t tail = _enqueue_pos.load(std::memory_order_relaxed);
+        const std::size_t head = _dequeue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    bool enqueue(MessageType& message)
+    {
+        std::size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & _mask];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (cell.storage) MessageType(std::move(message));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<MessageType> dequeue()
+    {
+        std::size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & _mask];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    MessageType* stored = cell.message();
+                    std::optional<MessageType> result(std::move(*stored));
+                    stored->~MessageType();
+                    cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return result;
+                }
+            }
+            else if (diff < 0) {
+                return std::nullopt;
+            }
+            else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+}
+
+#endif
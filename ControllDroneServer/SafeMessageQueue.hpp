@@ -11,7 +11,7 @@
 namespace drone
 {
 /// <summary>
-/// -  
+/// Поточно-безопасная очередь сообщений
 /// </summary>
 template <typename MessageType>
 class SafeMessageQueue
@@ -23,7 +23,7 @@ private:
 
 public:
     /// <summary>
-    ///    
+    /// Добавление сообщения в очередь
     /// </summary>
     template <typename T>
     void push(T&& message)
@@ -34,13 +34,13 @@ public:
     }
 
     /// <summary>
-    ///    
+    /// Удаление сообщения из очереди
     /// </summary>
     MessageType pop()
     {
         std::unique_lock<std::mutex> lock(_mtx);
         _cond_var.wait(lock, [this]() { return !_messages.empty(); });
-        auto result = _messages.front();
+        auto result = std::move(_messages.front());
         _messages.pop();
         return result;
     }
@@ -0,0 +1,614 @@
+#ifndef SYNTHETIC_BACKEND_HPP
+#define SYNTHETIC_BACKEND_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DroneBackend.hpp"
+#include "DroneRpc.hpp"
+
+namespace drone
+{
+constexpr double SYNTHETIC_PI = 3.14159265358979323846;
+
+/// <summary>
+/// Параметры синтетического источника
+/// </summary>
+struct SyntheticSettings
+{
+    std::size_t vehicle_count = 1;
+    // Размер генерируемых кадров, пиксели BGR
+    std::uint32_t frame_width = 640;
+    std::uint32_t frame_height = 480;
+    // Точка старта
+    double home_latitude = 47.641468;
+    double home_longitude = -122.140165;
+    float home_altitude = 122.0f;
+    // Шум сенсоров, СКО
+    float barometer_noise = 0.1f;    // м
+    float imu_noise = 0.02f;         // м/с2 и рад/с
+    float magnetometer_noise = 0.002f; // Гс
+};
+
+/// <summary>
+/// Кинематическая модель дрона: скорость и рысканье задаются командами
+/// мгновенно, положение интегрируется по времени при каждом обращении.
+/// Состояние общее для всех соединений дрона и защищено мьютексом.
+/// </summary>
+class SyntheticVehicle
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    enum class Mode
+    {
+        Hover,
+        Velocity, // скорость в NED до окончания команды, высота может удерживаться
+        Position  // полёт в точку с заданной скоростью
+    };
+
+    std::mutex _mtx;
+    Clock::time_point _updated = Clock::now();
+    Vector3r _position{ 0, 0, 0 }; // NED от точки старта, м
+    Vector3r _velocity{ 0, 0, 0 };
+    float _yaw = 0.0f;      // рад
+    float _yaw_rate = 0.0f; // рад/с
+
+    Mode _mode = Mode::Hover;
+    Clock::time_point _until{};
+    Vector3r _command_velocity{ 0, 0, 0 };
+    bool _hold_z = false;
+    float _target_z = 0.0f;
+    Vector3r _target{ 0, 0, 0 };
+    float _speed = 0.0f;
+    float _command_yaw_rate = 0.0f;
+
+public:
+    /// <summary>
+    /// Снимок состояния на текущий момент
+    /// </summary>
+    struct State
+    {
+        Vector3r position;
+        Vector3r velocity;
+        float yaw = 0.0f;
+        float yaw_rate = 0.0f;
+    };
+
+    State state()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        advance();
+        return State{ _position, _velocity, _yaw, _yaw_rate };
+    }
+
+    void arm(const bool armed)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        advance();
+        if (!armed) {
+            setHover();
+        }
+    }
+
+    void hover()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        advance();
+        setHover();
+    }
+
+    /// <summary>
+    /// Полёт со скоростью в NED в течение duration сек
+    /// </summary>
+    /// <param name="hold_z">Удерживать высоту target_z вместо вертикальной скорости</param>
+    void velocity(const Vector3r& velocity, const float yaw_rate_deg, const float duration, const bool hold_z = false, const float target_z = 0.0f)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        advance();
+        _mode = Mode::Velocity;
+        _command_velocity = velocity;
+        _command_yaw_rate = yaw_rate_deg * static_cast<float>(SYNTHETIC_PI / 180.0);
+        _hold_z = hold_z;
+        _target_z = target_z;
+        _until = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(duration));
+    }
+
+    /// <summary>
+    /// Полёт со скоростью в связанной системе, скорость рысканья в град/с
+    /// </summary>
+    void velocityBody(const float vx, const float vy, const float vz, const float yaw_rate_deg, const float duration)
+    {
+        float yaw = 0.0f;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            advance();
+            yaw = _yaw;
+        }
+        const float north = vx * std::cos(yaw) - vy * std::sin(yaw);
+        const float east = vx * std::sin(yaw) + vy * std::cos(yaw);
+        velocity(Vector3r(north, east, vz), yaw_rate_deg, duration);
+    }
+
+    void moveTo(const Vector3r& target, const float speed)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        advance();
+        _mode = Mode::Position;
+        _target = target;
+        _speed = speed;
+        _command_yaw_rate = 0.0f;
+    }
+
+private:
+    void setHover()
+    {
+        _mode = Mode::Hover;
+        _velocity = Vector3r(0, 0, 0);
+        _yaw_rate = 0.0f;
+    }
+
+    /// <summary>
+    /// Интегрирование от прошлого обращения до текущего момента
+    /// </summary>
+    void advance()
+    {
+        const Clock::time_point now = Clock::now();
+        Clock::time_point end = now;
+        if (_mode == Mode::Velocity && _until < now) {
+            end = std::max(_until, _updated);
+        }
+        const float dt = std::chrono::duration<float>(end - _updated).count();
+        _updated = now;
+
+        switch (_mode) {
+        case Mode::Hover:
+            break;
+        case Mode::Velocity: {
+            _velocity = _command_velocity;
+            if (_hold_z) {
+                _velocity.z() = 0.0f;
+                _position.z() = _target_z;
+            }
+            _yaw_rate = _command_yaw_rate;
+            _position = Vector3r(_position.x() + _velocity.x() * dt,
+                                 _position.y() + _velocity.y() * dt,
+                                 _position.z() + _velocity.z() * dt);
+            _yaw += _yaw_rate * dt;
+            if (end != now) {
+                setHover();
+            }
+            break;
+        }
+        case Mode::Position: {
+            const float dx = _target.x() - _position.x();
+            const float dy = _target.y() - _position.y();
+            const float dz = _target.z() - _position.z();
+            const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+            const float step = _speed * dt;
+            if (distance <= step || distance <= 0.0f) {
+                _position = _target;
+                setHover();
+            }
+            else {
+                const float k = step / distance;
+                _position = Vector3r(_position.x() + dx * k, _position.y() + dy * k, _position.z() + dz * k);
+                _velocity = Vector3r(dx / distance * _speed, dy / distance * _speed, dz / distance * _speed);
+            }
+            break;
+        }
+        }
+        // Земля
+        if (_position.z() > 0.0f) {
+            _position.z() = 0.0f;
+            _velocity.z() = 0.0f;
+        }
+    }
+};
+
+/// <summary>
+/// Общее состояние синтетического мира: дроны и параметры
+/// </summary>
+class SyntheticWorld
+{
+private:
+    SyntheticSettings _settings;
+    std::vector<std::unique_ptr<SyntheticVehicle>> _vehicles;
+    std::vector<std::string> _names;
+
+public:
+    explicit SyntheticWorld(const SyntheticSettings& settings)
+        : _settings(settings)
+    {
+        const std::size_t count = std::max<std::size_t>(settings.vehicle_count, 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            _vehicles.push_back(std::make_unique<SyntheticVehicle>());
+            _names.push_back("synthetic-" + std::to_string(i));
+        }
+    }
+
+    const SyntheticSettings& settings() const
+    {
+        return _settings;
+    }
+
+    const std::vector<std::string>& names() const
+    {
+        return _names;
+    }
+
+    /// <summary>
+    /// Дрон по имени, неизвестное или пустое имя - первый дрон
+    /// </summary>
+    SyntheticVehicle& vehicle(const std::string& name)
+    {
+        const auto it = std::find(_names.begin(), _names.end(), name);
+        const std::size_t index = it == _names.end() ? 0 : static_cast<std::size_t>(it - _names.begin());
+        return *_vehicles[index];
+    }
+};
+
+/// <summary>
+/// Синтетический источник без симулятора: кинематика, модель сенсоров
+/// с шумом и кадры, рисуемые по положению и курсу дрона.
+/// Нужен для нагрузочной проверки сервера без AirSim.
+/// </summary>
+class SyntheticBackend : public DroneBackend
+{
+private:
+    static constexpr float GRAVITY = 9.80665f;
+    static constexpr double EARTH_RADIUS = 6378137.0;
+
+    std::shared_ptr<SyntheticWorld> _world;
+    SyntheticVehicle& _vehicle;
+    std::string _vehicle_name;
+    std::mt19937 _random;
+    std::normal_distribution<float> _noise{ 0.0f, 1.0f };
+    float _box_z = 0.0f;
+    float _speed = 5.0f;
+    bool _yaw_is_rate = false;
+    float _yaw_or_rate = 0.0f;
+
+public:
+    SyntheticBackend(std::shared_ptr<SyntheticWorld> world, const std::string& vehicle_name)
+        : _world(std::move(world)),
+          _vehicle(_world->vehicle(vehicle_name)),
+          _vehicle_name(vehicle_name),
+          _random(static_cast<std::uint32_t>(std::hash<std::string>()(vehicle_name)))
+    {
+    }
+
+    const std::string& vehicleName() const override
+    {
+        return _vehicle_name;
+    }
+
+    std::vector<std::string> listVehicles() override
+    {
+        return _world->names();
+    }
+
+    void connection() override {}
+
+    void armDisarm(bool arm = true) override
+    {
+        _vehicle.arm(arm);
+    }
+
+    void setParams(const DroneMethodReq& request) override
+    {
+        _speed = request.speed > 0.0f ? request.speed : _speed;
+        _yaw_is_rate = request.yaw_is_rate;
+        _yaw_or_rate = request.yaw_or_rate;
+    }
+
+    double takeoff(const float takeoff_timeout = 5) override
+    {
+        const Vector3r position = _vehicle.state().position;
+        _vehicle.moveTo(Vector3r(position.x(), position.y(), -3.0f), 1.0f);
+        return takeoff_timeout;
+    }
+
+    void landing() override
+    {
+        const Vector3r position = _vehicle.state().position;
+        _vehicle.moveTo(Vector3r(position.x(), position.y(), 0.0f), 1.0f);
+    }
+
+    void enableApiControl() override {}
+
+    void velocityBodyFrame(const float vx, const float vy, const float vz, const float yaw_rate, const float duration) override
+    {
+        _vehicle.velocityBody(vx, vy, vz, yaw_rate, duration);
+    }
+
+    Vector3r position() override
+    {
+        return _vehicle.state().position;
+    }
+
+    bool landed() override
+    {
+        // Модель прижимает дрон к земле на нулевой высоте
+        return _vehicle.state().position.z() >= 0.0f;
+    }
+
+    void moveToPosition(const Vector3r& target, const float velocity, const DrivetrainType drivetrain, const YawMode& yaw_mode) override
+    {
+        (void)drivetrain;
+        (void)yaw_mode;
+        _vehicle.moveTo(target, velocity);
+    }
+
+    void hover() override
+    {
+        _vehicle.hover();
+    }
+
+    void cancel() override
+    {
+        _vehicle.hover();
+    }
+
+    double testFlyBoxLeg(const std::size_t leg, const float speed = 3.0f, const float size = 10.0f) override
+    {
+        static const float directions[TEST_FLY_BOX_LEGS][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+        if (leg == 0) {
+            _box_z = _vehicle.state().position.z();
+        }
+        const float duration = size / speed;
+        const float* direction = directions[leg % TEST_FLY_BOX_LEGS];
+        _vehicle.velocity(Vector3r(speed * direction[0], speed * direction[1], 0), 0.0f, duration, true, _box_z);
+        return duration;
+    }
+
+    double toUpFly() override
+    {
+        return fly(0.0f, 0.0f, -1.0f, 2.0f);
+    }
+
+    double toDownFly() override
+    {
+        return fly(0.0f, 0.0f, 1.0f, 2.0f);
+    }
+
+    double toForwardFly() override
+    {
+        return fly(1.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    double toRightFly() override
+    {
+        return fly(0.0f, 1.0f, 0.0f, 1.0f);
+    }
+
+    double toLeftFly() override
+    {
+        return fly(0.0f, -1.0f, 0.0f, 1.0f);
+    }
+
+    double toBackFly() override
+    {
+        return fly(-1.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    double rotateByYaw(bool left = true) override
+    {
+        const float duration = 1.0f;
+        float yaw_rate = left ? 4.0f : -4.0f;
+        if (_yaw_is_rate) {
+            yaw_rate = left ? _yaw_or_rate : -_yaw_or_rate;
+        }
+        _vehicle.velocity(Vector3r(0, 0, 0), yaw_rate, duration);
+        return duration;
+    }
+
+    BarometerSensorDataRep barometerData() override
+    {
+        const SyntheticVehicle::State state = _vehicle.state();
+        BarometerSensorDataRep data;
+        data.time_point = now();
+        data.altitude = _world->settings().home_altitude - state.position.z() + noise(_world->settings().barometer_noise);
+        data.pressure = static_cast<float>(101325.0 * std::pow(1.0 - 2.25577e-5 * data.altitude, 5.25588));
+        data.qnh = 1013.25f;
+        return data;
+    }
+
+    ImuSensorDataRep imuData() override
+    {
+        const SyntheticVehicle::State state = _vehicle.state();
+        const float sigma = _world->settings().imu_noise;
+        ImuSensorDataRep data;
+        data.time_point = now();
+        data.angular_velocity_x = noise(sigma);
+        data.angular_velocity_y = noise(sigma);
+        data.angular_velocity_z = state.yaw_rate + noise(sigma);
+        data.linear_acceleration_x = noise(sigma);
+        data.linear_acceleration_y = noise(sigma);
+        data.linear_acceleration_z = -GRAVITY + noise(sigma);
+        return data;
+    }
+
+    GpsSensorDataRep gpsData() override
+    {
+        const SyntheticVehicle::State state = _vehicle.state();
+        const SyntheticSettings& settings = _world->settings();
+        const double latitude_rad = settings.home_latitude * SYNTHETIC_PI / 180.0;
+        GpsSensorDataRep data;
+        data.time_point = now();
+        data.latitude = settings.home_latitude + state.position.x() / EARTH_RADIUS * 180.0 / SYNTHETIC_PI;
+        data.longitude = settings.home_longitude + state.position.y() / (EARTH_RADIUS * std::cos(latitude_rad)) * 180.0 / SYNTHETIC_PI;
+        data.altitude = settings.home_altitude - state.position.z();
+        data.velocity_x = state.velocity.x();
+        data.velocity_y = state.velocity.y();
+        data.velocity_z = state.velocity.z();
+        data.eph = 0.5f;
+        data.epv = 0.8f;
+        data.is_valid = true;
+        return data;
+    }
+
+    MagnetometerSensorDataRep magnetometerData() override
+    {
+        // Поле Земли в NED (Гс), повёрнутое на курс дрона
+        const float north = 0.2f;
+        const float down = 0.45f;
+        const float yaw = _vehicle.state().yaw;
+        const float sigma = _world->settings().magnetometer_noise;
+        MagnetometerSensorDataRep data;
+        data.time_point = now();
+        data.x = north * std::cos(yaw) + noise(sigma);
+        data.y = -north * std::sin(yaw) + noise(sigma);
+        data.z = down + noise(sigma);
+        return data;
+    }
+
+    /// <summary>
+    /// Кадры BGR: небо и земля с горизонтом по высоте и полосы, смещаемые курсом и положением
+    /// </summary>
+    std::vector<CameraFrame> cameraFrames(const std::vector<DroneCamera>& cameras, const bool compress = true) override
+    {
+        (void)compress;
+        const SyntheticVehicle::State state = _vehicle.state();
+        const SyntheticSettings& settings = _world->settings();
+        std::vector<CameraFrame> frames;
+        frames.reserve(cameras.size());
+        for (const DroneCamera camera : cameras) {
+            CameraFrame frame;
+            frame.camera = camera;
+            frame.time_stamp = now();
+            frame.width = settings.frame_width;
+            frame.height = settings.frame_height;
+            frame.encoding = ImageEncoding::Bgr8;
+            frame.position[0] = state.position.x();
+            frame.position[1] = state.position.y();
+            frame.position[2] = state.position.z();
+            frame.orientation[0] = std::cos(state.yaw / 2.0f);
+            frame.orientation[3] = std::sin(state.yaw / 2.0f);
+            render(frame, state, static_cast<int>(camera));
+            frames.push_back(std::move(frame));
+        }
+        return frames;
+    }
+
+    CameraInfo cameraInfo(const std::string& camera_name) override
+    {
+        (void)camera_name;
+        CameraInfo info;
+        info.fov = 90.0f;
+        return info;
+    }
+
+    /// <summary>
+    /// Глубина плоской земли под камерой, смотрящей горизонтально
+    /// </summary>
+    std::vector<ImageResponse> cameraPixelsDepth(const std::string& camera_name_val) override
+    {
+        const std::uint32_t width = 256;
+        const std::uint32_t height = 144;
+        const float altitude = std::max(-_vehicle.state().position.z(), 0.5f);
+        ImageResponse response;
+        response.camera_name = camera_name_val;
+        response.width = static_cast<int>(width);
+        response.height = static_cast<int>(height);
+        response.pixels_as_float = true;
+        response.compress = false;
+        response.time_stamp = now();
+        response.image_data_float.resize(static_cast<std::size_t>(width) * height);
+        for (std::uint32_t y = 0; y < height; ++y) {
+            // Ниже середины кадра луч пересекает землю, выше - дальняя граница
+            const float below = (static_cast<float>(y) + 0.5f - height / 2.0f) / (height / 2.0f);
+            const float depth = below > 0.0f ? std::min(altitude / below, 1000.0f) : 1000.0f;
+            std::fill_n(response.image_data_float.begin() + static_cast<std::ptrdiff_t>(y) * width, width, depth);
+        }
+        return { response };
+    }
+
+private:
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    float noise(const float sigma)
+    {
+        return sigma > 0.0f ? _noise(_random) * sigma : 0.0f;
+    }
+
+    /// <summary>
+    /// Полёт в направлении связанной системы, как у манёвров AirSim клиента
+    /// </summary>
+    double fly(const float forward, const float right, const float down, const float size)
+    {
+        const float duration = size / _speed;
+        _vehicle.velocityBody(forward * _speed, right * _speed, down * _speed, 0.0f, duration);
+        return duration;
+    }
+
+    static void render(CameraFrame& frame, const SyntheticVehicle::State& state, const int camera)
+    {
+        const std::uint32_t width = frame.width;
+        const std::uint32_t height = frame.height;
+        frame.bytes.resize(static_cast<std::size_t>(width) * height * 3);
+        if (width == 0 || height == 0) {
+            return;
+        }
+
+        // Горизонт опускается с высотой, полосы сдвигаются курсом и движением вперёд
+        const float altitude = std::max(-state.position.z(), 0.0f);
+        const std::uint32_t horizon = static_cast<std::uint32_t>(
+            std::clamp(height / 2.0f + altitude * 2.0f, 0.0f, static_cast<float>(height)));
+        const int shift = static_cast<int>(state.yaw / (2.0f * static_cast<float>(SYNTHETIC_PI)) * width * 4.0f)
+                          + static_cast<int>(state.position.y() * 20.0f) + camera * 97;
+        const int ground_shift = static_cast<int>(state.position.x() * 20.0f);
+
+        std::vector<std::uint8_t> stripes(static_cast<std::size_t>(width));
+        for (std::uint32_t x = 0; x < width; ++x) {
+            stripes[x] = static_cast<std::uint8_t>(((static_cast<int>(x) + shift) >> 5) & 1 ? 40 : 0);
+        }
+
+        std::uint8_t* pixel = frame.bytes.data();
+        for (std::uint32_t y = 0; y < height; ++y) {
+            const bool sky = y < horizon;
+            const std::uint8_t shade = static_cast<std::uint8_t>(sky ? 255 - y * 80 / height : 60 + ((static_cast<int>(y) + ground_shift) >> 4 & 1) * 30);
+            for (std::uint32_t x = 0; x < width; ++x) {
+                if (sky) {
+                    pixel[0] = shade;                                 // B
+                    pixel[1] = static_cast<std::uint8_t>(shade * 3 / 4); // G
+                    pixel[2] = static_cast<std::uint8_t>(shade / 2);  // R
+                }
+                else {
+                    pixel[0] = static_cast<std::uint8_t>(shade / 3);
+                    pixel[1] = static_cast<std::uint8_t>(shade + stripes[x]);
+                    pixel[2] = static_cast<std::uint8_t>(shade / 2 + stripes[x]);
+                }
+                pixel += 3;
+            }
+        }
+    }
+};
+
+/// <summary>
+/// Фабрика синтетических источников для реестра дронов
+/// </summary>
+inline DroneBackendFactory makeSyntheticBackendFactory(const SyntheticSettings& settings)
+{
+    auto world = std::make_shared<SyntheticWorld>(settings);
+    return [world](const std::string& vehicle_name) -> std::unique_ptr<DroneBackend> {
+        return std::make_unique<SyntheticBackend>(world, vehicle_name);
+    };
+}
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace drone
+{
+/// <summary>
+/// Хэшированное колесо таймеров с фиксированным шагом.
+/// Постановка и срабатывание таймера - O(1), без выделения памяти
+/// после прогрева.
+/// </summary>
+class TimerWheel
+{
+private:
+    struct Timer
+    {
+        std::size_t id = 0;
+        std::uint64_t rounds = 0; // полных оборотов колеса до срабатывания
+    };
+
+    struct Expired
+    {
+        std::size_t id = 0;
+        std::uint64_t late = 0;
+    };
+
+    std::vector<std::vector<Timer>> _slots;
+    std::vector<Expired> _expired;
+    std::size_t _cursor = 0;
+
+public:
+    /// <summary>
+    /// Создание колеса
+    /// </summary>
+    /// <param name="slot_count">Число ячеек колеса</param>
+    explicit TimerWheel(std::size_t slot_count = 256)
+        : _slots(slot_count > 0 ? slot_count : 1)
+    {
+    }
+
+    /// <summary>
+    /// Постановка таймера
+    /// </summary>
+    /// <param name="id">Идентификатор таймера</param>
+    /// <param name="delay_ticks">Задержка в шагах колеса, не менее 1</param>
+    void schedule(std::size_t id, std::uint64_t delay_ticks)
+    {
+        if (delay_ticks == 0) {
+            delay_ticks = 1;
+        }
+        const std::size_t slot_count = _slots.size();
+        const std::size_t slot = (_cursor + static_cast<std::size_t>(delay_ticks % slot_count)) % slot_count;
+        _slots[slot].push_back({ id, (delay_ticks - 1) / slot_count });
+    }
+
+    /// <summary>
+    /// Продвижение колеса на несколько шагов, например на время, прошедшее
+    /// с прошлого продвижения. Обработчики вызываются после всех шагов,
+    /// поэтому каждый таймер срабатывает не больше одного раза, а новые
+    /// таймеры отсчитываются от текущего положения колеса.
+    /// </summary>
+    /// <param name="ticks">Число шагов</param>
+    /// <param name="on_expired">Вызывается как on_expired(id, late) для каждого сработавшего
+    /// таймера, late - на сколько шагов срабатывание опоздало; может ставить новые таймеры</param>
+    template <typename Callback>
+    void advance(const std::uint64_t ticks, Callback on_expired)
+    {
+        _expired.clear();
+        for (std::uint64_t step = 0; step < ticks; ++step) {
+            _cursor = (_cursor + 1) % _slots.size();
+            std::vector<Timer>& slot = _slots[_cursor];
+
+            std::size_t kept = 0;
+            for (Timer& timer : slot) {
+                if (timer.rounds == 0) {
+                    _expired.push_back({ timer.id, ticks - 1 - step });
+                }
+                else {
+                    --timer.rounds;
+                    slot[kept++] = timer;
+                }
+            }
+            slot.resize(kept);
+        }
+
+        for (const Expired& expired : _expired) {
+            on_expired(expired.id, expired.late);
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef VEHICLE_REGISTRY_HPP
+#define VEHICLE_REGISTRY_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AirSimConnectionPool.hpp"
+#include "DroneAirSimClient.hpp"
+#include "DroneBackend.hpp"
+#include "DroneCameraCapture.hpp"
+#include "DroneCommandExecutor.hpp"
+#include "DroneTelemetry.hpp"
+#include "DepthQueryEngine.hpp"
+#include "DroneMission.hpp"
+#include "LatencyStats.hpp"
+#include "VisualServo.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Наибольшее число дронов: номер дрона передаётся одним байтом
+/// </summary>
+constexpr std::size_t MAX_VEHICLES = std::numeric_limits<std::uint8_t>::max() + 1;
+
+/// <summary>
+/// Настройки реестра дронов
+/// </summary>
+struct VehicleRegistrySettings
+{
+    std::string ip_address = "localhost";
+    std::uint16_t port = AIRSIM_RPC_PORT;
+    // Имена дронов из раздела Vehicles файла settings.json.
+    // Пусто - список запрашивается у симулятора, если и он пуст - один дрон по умолчанию
+    std::vector<std::string> vehicle_names;
+    CameraCaptureSettings capture;
+    VisualServoSettings servo;
+    // Источник данных дронов, пусто - AirSim по адресу ip_address:port
+    DroneBackendFactory backend;
+};
+
+/// <summary>
+/// Дрон: свои rpc соединения, исполнитель команд, телеметрия и захват изображений.
+/// Исполнитель, опрос сенсоров и захват работают в потоках этого дрона,
+/// поэтому медленный манёвр одного дрона не задерживает остальные.
+/// </summary>
+class DroneVehicle
+{
+private:
+    std::uint8_t _id;
+    AirSimConnectionPool _airsim;
+
+public:
+    DroneBackend& client; // клиент команд
+    DroneCommandExecutor executor;
+    TelemetryPublisher telemetry;
+    CameraCaptureEngine capture;
+    DepthQueryEngine depth;
+    DroneMission mission;
+    VisualServo servo;
+
+public:
+    DroneVehicle(const std::uint8_t id,
+                 const std::string& name,
+                 const VehicleRegistrySettings& settings,
+                 const DroneBackendFactory& backend)
+        : _id(id),
+          _airsim(backend, settings.capture.pipeline_depth, name),
+          client(_airsim.client(AirSimRole::Command)),
+          executor(client),
+          telemetry(_airsim.client(AirSimRole::Telemetry), id),
+          capture(_airsim, settings.capture, id),
+          depth(_airsim.client(AirSimRole::Depth)),
+          mission(client, telemetry),
+          servo(executor, settings.servo)
+    {
+    }
+
+    DroneVehicle(const DroneVehicle&) = delete;
+    DroneVehicle& operator=(const DroneVehicle&) = delete;
+
+    /// <summary>
+    /// Номер дрона в запросах, ответах, телеметрии и кадрах
+    /// </summary>
+    std::uint8_t id() const
+    {
+        return _id;
+    }
+
+    /// <summary>
+    /// Имя дрона в симуляторе
+    /// </summary>
+    const std::string& name() const
+    {
+        return client.vehicleName();
+    }
+
+    /// <summary>
+    /// Запись телеметрии и кадров дрона в журнал полёта
+    /// </summary>
+    void setRecorder(FlightRecorder* recorder)
+    {
+        telemetry.setRecorder(recorder);
+        capture.setRecorder(recorder);
+    }
+
+    /// <summary>
+    /// Учёт задержек команд и кадров дрона в общей статистике сервера
+    /// </summary>
+    void setStats(ServerStats* stats)
+    {
+        executor.setStats(stats);
+        capture.setStats(stats);
+    }
+
+    /// <summary>
+    /// Остановка потоков дрона
+    /// </summary>
+    void stop()
+    {
+        servo.stop();
+        executor.stop();
+        telemetry.stop();
+        capture.stop();
+        depth.stop();
+    }
+};
+
+/// <summary>
+/// Реестр дронов, номер дрона - индекс в порядке перечисления имён
+/// </summary>
+class VehicleRegistry
+{
+private:
+    std::vector<std::unique_ptr<DroneVehicle>> _vehicles;
+
+public:
+    explicit VehicleRegistry(const VehicleRegistrySettings& settings)
+    {
+        DroneBackendFactory backend = settings.backend;
+        if (!backend) {
+            backend = [ip_address = settings.ip_address, port = settings.port](const std::string& vehicle_name) {
+                return std::unique_ptr<DroneBackend>(std::make_unique<DroneAirSimClient>(ip_address, port, vehicle_name));
+            };
+        }
+
+        std::vector<std::string> names = settings.vehicle_names;
+        if (names.empty()) {
+            names = discover(backend);
+        }
+        if (names.empty()) {
+            names.emplace_back();
+        }
+        if (names.size() > MAX_VEHICLES) {
+            std::cerr << "Слишком много дронов: " << names.size() << ", используются первые " << MAX_VEHICLES << "\n";
+            names.resize(MAX_VEHICLES);
+        }
+
+        _vehicles.reserve(names.size());
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            _vehicles.push_back(std::make_unique<DroneVehicle>(static_cast<std::uint8_t>(i), names[i], settings, backend));
+            std::cout << "Дрон " << i << ": " << (names[i].empty() ? "по умолчанию" : names[i]) << '\n';
+        }
+    }
+
+    VehicleRegistry(const VehicleRegistry&) = delete;
+    VehicleRegistry& operator=(const VehicleRegistry&) = delete;
+
+    /// <summary>
+    /// Дрон по номеру из запроса
+    /// </summary>
+    /// <returns>nullptr, если дрона с таким номером нет</returns>
+    DroneVehicle* find(const std::uint8_t vehicle_id)
+    {
+        if (vehicle_id >= _vehicles.size()) {
+            return nullptr;
+        }
+        return _vehicles[vehicle_id].get();
+    }
+
+    std::size_t size() const
+    {
+        return _vehicles.size();
+    }
+
+    /// <summary>
+    /// Обход всех дронов
+    /// </summary>
+    template <typename Function>
+    void forEach(Function&& function)
+    {
+        for (const std::unique_ptr<DroneVehicle>& vehicle : _vehicles) {
+            function(*vehicle);
+        }
+    }
+
+    /// <summary>
+    /// Остановка потоков всех дронов
+    /// </summary>
+    void stop()
+    {
+        forEach([](DroneVehicle& vehicle) { vehicle.stop(); });
+    }
+
+private:
+    /// <summary>
+    /// Имена дронов, заданных в settings.json симулятора или записанных в журнал
+    /// </summary>
+    static std::vector<std::string> discover(const DroneBackendFactory& backend)
+    {
+        try {
+            return backend("")->listVehicles();
+        }
+        catch (...) {
+            std::cerr << "Ошибка получения списка дронов: " << backendErrorMessage() << "\n";
+        }
+        return {};
+    }
+};
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef VISUAL_SERVO_HPP
+#define VISUAL_SERVO_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "AsyncLog.hpp"
+#include "DroneCommandExecutor.hpp"
+
+namespace drone
+{
+/// <summary>
+/// Коэффициенты ПИД регулятора
+/// </summary>
+struct PidSettings
+{
+    float kp = 0.0f;
+    float ki = 0.0f;
+    float kd = 0.0f;
+    float output_limit = 0.0f;   // ограничение выхода по модулю
+    float integral_limit = 0.0f; // ограничение интегральной составляющей по модулю
+};
+
+/// <summary>
+/// ПИД регулятор с ограничением интеграла и производной по измерению
+/// </summary>
+class PidController
+{
+private:
+    PidSettings _settings;
+    float _integral = 0.0f;
+    float _last_error = 0.0f;
+    bool _has_last = false;
+
+public:
+    explicit PidController(const PidSettings& settings)
+        : _settings(settings)
+    {
+    }
+
+    /// <summary>
+    /// Новое значение выхода
+    /// </summary>
+    /// <param name="error">Рассогласование</param>
+    /// <param name="dt">Время с прошлого измерения, сек</param>
+    float update(const float error, const float dt)
+    {
+        float derivative = 0.0f;
+        if (_has_last && dt > 0.0f) {
+            derivative = (error - _last_error) / dt;
+            _integral = std::clamp(_integral + error * dt, -_settings.integral_limit, _settings.integral_limit);
+        }
+        _last_error = error;
+        _has_last = true;
+
+        const float output = _settings.kp * error + _settings.ki * _integral + _settings.kd * derivative;
+        return std::clamp(output, -_settings.output_limit, _settings.output_limit);
+    }
+
+    void reset()
+    {
+        _integral = 0.0f;
+        _last_error = 0.0f;
+        _has_last = false;
+    }
+};
+
+/// <summary>
+/// Параметры визуального сопровождения
+/// </summary>
+struct VisualServoSettings
+{
+    // Частота выдачи уставок, как частота кадров камеры
+    double rate_hz = 30.0;
+    // Без новых положений цели дольше этого времени сопровождение отключается
+    std::chrono::milliseconds target_timeout{ 500 };
+    // Зона нечувствительности по нормированному смещению цели
+    float deadband = 0.02f;
+    // Смещение по горизонтали (-1..1, вправо) -> скорость рысканья, град/с
+    PidSettings yaw{ 30.0f, 2.0f, 3.0f, 30.0f, 5.0f };
+    // Смещение по вертикали (-1..1, вниз) -> вертикальная скорость (вниз), м/с
+    PidSettings vertical{ 1.5f, 0.1f, 0.2f, 2.0f, 5.0f };
+};
+
+/// <summary>
+/// Визуальное сопровождение цели на сервере.
+/// Клиент присылает положение цели в кадре, регуляторы рысканья и высоты
+/// пересчитываются на каждое новое положение, уставки скорости передаются
+/// исполнителю с частотой кадров камеры. Без новых положений цели
+/// уставки прекращаются и исполнитель переводит дрон в зависание.
+/// </summary>
+class VisualServo
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    DroneCommandExecutor& _executor;
+    VisualServoSettings _settings;
+    PidController _yaw_pid;
+    PidController _vertical_pid;
+
+    std::mutex _mtx;
+    std::condition_variable _cond_var;
+    bool _running = true;
+    bool _engaged = false;
+    float _error_x = 0.0f;
+    float _error_y = 0.0f;
+    Clock::time_point _observed{};
+    std::uint64_t _observation = 0; // номер последнего положения цели
+    std::thread _thread;
+
+public:
+    VisualServo(DroneCommandExecutor& executor, const VisualServoSettings& settings = VisualServoSettings())
+        : _executor(executor),
+          _settings(settings),
+          _yaw_pid(settings.yaw),
+          _vertical_pid(settings.vertical),
+          _thread(&VisualServo::loop, this)
+    {
+    }
+
+    ~VisualServo()
+    {
+        stop();
+    }
+
+    VisualServo(const VisualServo&) = delete;
+    VisualServo& operator=(const VisualServo&) = delete;
+
+    /// <summary>
+    /// Новое положение цели, включает сопровождение
+    /// </summary>
+    /// <param name="error_x">Смещение цели от центра кадра по горизонтали, -1..1, вправо</param>
+    /// <param name="error_y">Смещение цели от центра кадра по вертикали, -1..1, вниз</param>
+    void observe(const float error_x, const float error_y)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (!_engaged) {
+                DRONE_LOG_INFO("Сопровождение цели включено");
+            }
+            _engaged = true;
+            _error_x = std::clamp(error_x, -1.0f, 1.0f);
+            _error_y = std::clamp(error_y, -1.0f, 1.0f);
+            _observed = Clock::now();
+            ++_observation;
+        }
+        _cond_var.notify_all();
+    }
+
+    /// <summary>
+    /// Отключение сопровождения, например по команде оператора
+    /// </summary>
+    void disengage()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_engaged) {
+            DRONE_LOG_INFO("Сопровождение цели выключено");
+        }
+        _engaged = false;
+    }
+
+    /// <summary>
+    /// Остановка потока
+    /// </summary>
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _running = false;
+        }
+        _cond_var.notify_all();
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+private:
+    /// <summary>
+    /// Цикл выдачи уставок с частотой кадров
+    /// </summary>
+    void loop()
+    {
+        const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _settings.rate_hz));
+        std::uint64_t last_observation = 0;
+        Clock::time_point last_observed{};
+        VelocitySetpoint setpoint;
+        bool active = false;
+        Clock::time_point next_tick = Clock::now();
+
+        std::unique_lock<std::mutex> lock(_mtx);
+        while (_running) {
+            if (!_engaged) {
+                active = false;
+                _cond_var.wait(lock, [this]() { return _engaged || !_running; });
+                next_tick = Clock::now();
+                continue;
+            }
+
+            const Clock::time_point now = Clock::now();
+            if (now - _observed > _settings.target_timeout) {
+                // Цель потеряна: уставки прекращаются, исполнитель сам зависает
+                DRONE_LOG_WARN("Цель потеряна, сопровождение выключено");
+                _engaged = false;
+                continue;
+            }
+
+            if (!active) {
+                _yaw_pid.reset();
+                _vertical_pid.reset();
+                setpoint = VelocitySetpoint();
+                last_observed = _observed;
+                active = true;
+            }
+            if (_observation != last_observation) {
+                // Регуляторы пересчитываются только по новому положению цели
+                const float dt = std::chrono::duration<float>(_observed - last_observed).count();
+                setpoint.yaw_rate = _yaw_pid.update(applyDeadband(_error_x), dt);
+                setpoint.vz = _vertical_pid.update(applyDeadband(_error_y), dt);
+                last_observation = _observation;
+                last_observed = _observed;
+            }
+
+            // Под блокировкой: после disengage() уставок больше не будет
+            // и следующая команда оператора не вытесняется сопровождением
+            if (!_executor.setpoint(setpoint)) {
+                // Выполняется команда безопасности (посадка, зависание)
+                DRONE_LOG_WARN("Сопровождение выключено командой безопасности");
+                _engaged = false;
+                continue;
+            }
+
+            next_tick += period;
+            if (next_tick < now) {
+                next_tick = now + period;
+            }
+            _cond_var.wait_until(lock, next_tick, [this]() { return !_running || !_engaged; });
+        }
+    }
+
+    float applyDeadband(const float error) const
+    {
+        return std::fabs(error) < _settings.deadband ? 0.0f : error;
+    }
+};
+}
+
+#endif
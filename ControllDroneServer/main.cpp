@@ -13,27 +13,134 @@ STRICT_MODE_ON
 #include "common/common_utils/FileSystem.hpp"
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <locale>
+#include <string>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include <compat/nanomsg/nn.h>
 #include <compat/nanomsg/reqrep.h>
 
+#include "AsyncLog.hpp"
 #include "DroneApplication.hpp"
+#include "FlightReplay.hpp"
+#include "SyntheticBackend.hpp"
 
-int main()
+int main(int argc, char* argv[])
 {
     setlocale(LC_ALL, ".UTF-8");
+#ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
+#endif
 
     std::locale::global(std::locale(""));
     std::wcout.imbue(std::locale(""));
 
-    drone::DroneApplication app;
+    // Передняя камера и камера FPV захватываются вместе с выбранной клиентом
+    drone::VehicleRegistrySettings settings;
+    drone::CameraCaptureSettings& capture = settings.capture;
+    capture.cameras_fps[drone::DroneCamera::front_center] = 30.0;
+    capture.cameras_fps[drone::DroneCamera::fpv] = 30.0;
+    capture.default_fps = 30.0;
+    capture.pipeline_depth = 2;
+    capture.encoder.encoding = drone::ImageEncoding::Jpeg;
+    capture.encoder.jpeg_quality = 80;
+    // Список дронов не задан: берутся все дроны из settings.json симулятора
+
+    // --replay <файл> [--replay-speed <x>]: журнал полёта вместо AirSim,
+    // скорость 1 - реальное время, 0 - как можно быстрее
+    // --synthetic [--synthetic-vehicles <n>] [--synthetic-frame <ширина>x<высота>]:
+    // синтетические дроны без симулятора для нагрузочной проверки
+    // --log <файл> [--log-level <уровень>] [--log-console-level <уровень>]:
+    // двоичный журнал сообщений, расшифровывается drone_log_decoder;
+    // уровни trace, debug, info, warn, error, off
+    drone::ReplaySettings replay;
+    drone::SyntheticSettings synthetic;
+    drone::AsyncLogSettings log;
+    bool use_synthetic = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (option == "--replay") {
+            replay.path = value;
+        }
+        else if (option == "--replay-speed") {
+            replay.speed = std::atof(value);
+        }
+        else if (option == "--log") {
+            log.path = value;
+        }
+        else if ((option == "--log-level" && !drone::parseLogLevel(value, log.level))
+                 || (option == "--log-console-level" && !drone::parseLogLevel(value, log.console_level))) {
+            std::cerr << "Неизвестный уровень журнала: " << value << "\n";
+            return -1;
+        }
+        else if (option == "--synthetic") {
+            use_synthetic = true;
+        }
+        else if (option == "--synthetic-vehicles") {
+            synthetic.vehicle_count = static_cast<std::size_t>(std::atoi(value));
+        }
+        else if (option == "--synthetic-frame") {
+            unsigned width = 0;
+            unsigned height = 0;
+            if (std::sscanf(value, "%ux%u", &width, &height) == 2) {
+                synthetic.frame_width = width;
+                synthetic.frame_height = height;
+            }
+        }
+    }
+    drone::AsyncLog::instance().start(log);
+
+    if (use_synthetic) {
+        settings.backend = drone::makeSyntheticBackendFactory(synthetic);
+    }
+    else if (!replay.path.empty()) {
+        settings.backend = drone::makeReplayBackendFactory(replay);
+        if (!settings.backend) {
+            return -1;
+        }
+    }
+
+    drone::DroneApplication app(settings);
+
+    // --record <файл>: журнал полёта с командами, телеметрией и кадрами
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--record") {
+            if (app.initFlightRecorder(argv[i + 1]) < 0) {
+                return -1;
+            }
+            break;
+        }
+    }
+
     const std::string endpoint = "tcp://127.0.0.1:20001";
     if (app.initRpcControllServer(endpoint) < 0) {
         return -1;
     }
 
-    return app.run();
+    const std::string async_endpoint = "tcp://127.0.0.1:20004";
+    if (app.initAsyncControlServer(async_endpoint) < 0) {
+        return -1;
+    }
+
+    drone::TelemetryRates rates;
+    rates.imu_hz = 100.0;
+    rates.gps_hz = 10.0;
+    const std::string telemetry_endpoint = "tcp://127.0.0.1:20003";
+    if (app.initTelemetryServer(telemetry_endpoint, rates) < 0) {
+        return -1;
+    }
+
+    const std::string camera_endpoint = "tcp://127.0.0.1:20002";
+    if (app.initCameraServer(camera_endpoint) < 0) {
+        return -1;
+    }
+
+    const int result = app.run();
+    drone::AsyncLog::instance().stop();
+    return result;
 }
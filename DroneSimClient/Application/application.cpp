@@ -4,6 +4,7 @@
 #include <QThread>
 #include <windows.h>
 #include "application.h"
+#include "../ControllDroneServer/AsyncLog.hpp"
 #include "MainWindow/mainwindow.h"
 #include "Controller/controller.h"
 #include "ImageServer/imageserver.h"
@@ -24,6 +25,20 @@ Application::~Application()
 
 int Application::run()
 {
+    // --log <файл> [--log-level <уровень>]: двоичный журнал сообщений
+    // потоков приёма кадров и AI, расшифровывается drone_log_decoder
+    drone::AsyncLogSettings log;
+    const QStringList args = arguments();
+    for (int i = 1; i + 1 < args.size(); ++i) {
+        if (args[i] == "--log") {
+            log.path = args[i + 1].toStdString();
+        }
+        else if (args[i] == "--log-level" && !drone::parseLogLevel(args[i + 1].toStdString(), log.level)) {
+            qWarning() << "Неизвестный уровень журнала:" << args[i + 1];
+        }
+    }
+    drone::AsyncLog::instance().start(log);
+
     // VAS: здесь QSharedPointer только для RAII
     QSharedPointer<Controller> controller = QSharedPointer<Controller>(new Controller());
     if (!controller->setInit()) {
@@ -53,5 +68,7 @@ int Application::run()
     imageServer->moveToThread(thread);
     thread->start();
 
-    return exec();
+    const int result = exec();
+    drone::AsyncLog::instance().stop();
+    return result;
 }
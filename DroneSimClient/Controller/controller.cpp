@@ -1,9 +1,13 @@
+#include <chrono>
+#include <cstring>
 #include <QDateTime>
 #include <QtConcurrent>
 #include <compat/nanomsg/nn.h>
-#include <compat/nanomsg/reqrep.h>
+#include <compat/nanomsg/pair.h>
 #include <compat/nanomsg/pipeline.h>
+#include <compat/nanomsg/pubsub.h>
 #include "controller.h"
+#include "../ControllDroneServer/AsyncLog.hpp"
 
 Controller::Controller(QObject *parent)
     : QObject(parent)
@@ -13,15 +17,23 @@ Controller::Controller(QObject *parent)
     qRegisterMetaType<ImuSensorDataRep>("ImuSensorDataRep");
     qRegisterMetaType<GpsSensorDataRep>("GpsSensorDataRep");
     qRegisterMetaType<MagnetometerSensorDataRep>("MagnetometerSensorDataRep");
+    qRegisterMetaType<drone::ImageFrameHeader>("drone::ImageFrameHeader");
 
     _timer = QSharedPointer<QTimer>(new QTimer(this));
     connect(_timer.data(), &QTimer::timeout, this, &Controller::slotTimeOut);
     _timer->start(50);
+
+    // Уставки скорости 50 Гц, сервер зависает, если уставки перестают приходить
+    _teleopTimer = QSharedPointer<QTimer>(new QTimer(this));
+    _teleopTimer->setTimerType(Qt::PreciseTimer);
+    connect(_teleopTimer.data(), &QTimer::timeout, this, &Controller::slotTeleopTimeOut);
 }
 
 Controller::~Controller()
 {
      _isStarted = false;
+    _futureTelemetry.waitForFinished();
+    _futureReply.waitForFinished();
     if (_clientSock > -1) {
         nn_shutdown(_clientSock, 0);
         nn_close(_clientSock);
@@ -30,13 +42,19 @@ Controller::~Controller()
 
 bool Controller::setInit()
 {
-    _clientSock = nn_socket(AF_SP, NN_REQ);
+    // Асинхронный канал команд: запросы не ждут ответа на предыдущие
+    _clientSock = nn_socket(AF_SP, NN_PAIR);
     if (_clientSock < 0) {
         qDebug() << "Ошибка инициализации socket";
         return false;
     }
 
-    const char* endpoint = "tcp://127.0.0.1:20001";
+    int to = 100;
+    if (nn_setsockopt(_clientSock, NN_SOL_SOCKET, NN_RCVTIMEO, &to, sizeof(to)) < 0) {
+        qDebug() << "Ошибка set socket options";
+    }
+
+    const char* endpoint = "tcp://127.0.0.1:20004";
     if (nn_connect(_clientSock, endpoint) < 0) {
         qDebug() << "Ошибка соединения с сервером";
         nn_close(_clientSock);
@@ -49,53 +67,159 @@ bool Controller::setInit()
         qDebug() << "Start cameraImageLoop";
     }
 
+    if (!_futureTelemetry.isRunning()) {
+        _futureTelemetry = QtConcurrent::run(this, &Controller::telemetryLoop);
+        qDebug() << "Start telemetryLoop";
+    }
+
+    if (!_futureReply.isRunning()) {
+        _futureReply = QtConcurrent::run(this, &Controller::replyLoop);
+        qDebug() << "Start replyLoop";
+    }
+
     return true;
 }
 
-bool Controller::sendRequest(drone::DroneMethodReq *request)
+bool Controller::sendRequest(drone::DroneMethodReq *request, const QByteArray &payload)
 {
-    int sendResult = nn_send(_clientSock, request, sizeof(drone::DroneMethodReq), 0);
+    // Идентификатор связывает запрос с ответом, пришедшим в любом порядке
+    request->request_id = ++_nextRequestId;
+    {
+        QMutexLocker locker(&_pendingMutex);
+        _pendingRequests.insert(request->request_id, {request->method, QDateTime::currentMSecsSinceEpoch()});
+    }
+
+    // Запрос в конверте протокола: заголовок, тело и данные (маршрут миссии)
+    const std::size_t payloadSize = static_cast<std::size_t>(payload.size());
+    QByteArray message(static_cast<int>(drone::wireSize<drone::DroneMethodReq>(payloadSize)), Qt::Uninitialized);
+    std::byte *payloadPtr = drone::encodeWire(reinterpret_cast<std::byte*>(message.data()),
+                                              drone::WireKind::Request, *request, payloadSize);
+    if (payloadSize > 0) {
+        std::memcpy(payloadPtr, payload.constData(), payloadSize);
+    }
+    int sendResult = nn_send(_clientSock, message.constData(), static_cast<size_t>(message.size()), 0);
     if (sendResult < 0) {
+        QMutexLocker locker(&_pendingMutex);
+        _pendingRequests.remove(request->request_id);
         _errorText = QString("[%1] Ошибка отправки команды").arg(_methodNames.value(request->method));
         qDebug() << _errorText;
         return false;
-    } else {
-        _requestText = QString("--> [%1] Команда отправлена").arg(_methodNames.value(request->method));
-         emit signalSendRequest(false, _requestText);
-
-        // Ожидание ответа от сервера
-        char buffer[drone::MSG_BUFFER_SIZE] = { 0 };
-        int recvResult = nn_recv(_clientSock, buffer, sizeof(buffer), 0);
-        drone::DroneReply *reply = reinterpret_cast<drone::DroneReply*>(buffer);
-        if (recvResult > 0 && reply != nullptr) {
-            _replyText = QString("<-- [%1] Получен ответ от сервера").arg(_methodNames.value(reply->method));
-            emit signalBarometerSensorData(reply->barometer);
-            emit signalImuSensorData(reply->imu);
-            if (reply->gps.is_valid) {
-                emit signalGpsSensorData(reply->gps);
+    }
+
+    _requestText = QString("--> [%1] #%2 Команда отправлена")
+                       .arg(_methodNames.value(request->method))
+                       .arg(request->request_id);
+    return true;
+}
+
+void Controller::replyLoop()
+{
+    const QMap<drone::ReplyStatus, QString> statusNames = {
+        {drone::ReplyStatus::Accepted, "принята"},
+        {drone::ReplyStatus::Completed, "выполнена"},
+        {drone::ReplyStatus::Preempted, "прервана"},
+        {drone::ReplyStatus::Rejected, "отклонена"},
+        {drone::ReplyStatus::Expired, "просрочена"},
+        {drone::ReplyStatus::Failed, "ошибка AirSim"}
+    };
+
+    while (_isStarted)
+    {
+        // Буфер выделяет nanomsg под реальный размер ответа
+        char *buf = nullptr;
+        int bytes = nn_recv(_clientSock, &buf, NN_MSG, 0);
+        if (bytes < 0) {
+            continue;
+        }
+
+        const std::optional<drone::WireMessage<drone::DroneReplyView>> message =
+            drone::decodeWire<drone::DroneReplyView>(reinterpret_cast<const std::byte*>(buf),
+                                                     static_cast<std::size_t>(bytes),
+                                                     drone::WireKind::Reply);
+        if (!message || !message->framed || !message->body.has_request_id()) {
+            DRONE_LOG_WARN("Неверный формат ответа, размер: {}", bytes);
+            nn_freemsg(buf);
+            continue;
+        }
+
+        // Поля читаются из буфера nanomsg, отсутствующие - по умолчанию
+        const drone::DroneReplyView &reply = message->body;
+        const bool selectedVehicle = reply.vehicle_id() == _vehicle_id;
+        std::optional<PendingRequest> pending;
+        {
+            QMutexLocker locker(&_pendingMutex);
+            const auto it = _pendingRequests.find(reply.request_id());
+            if (it != _pendingRequests.end()) {
+                pending = it.value();
+                _pendingRequests.erase(it);
             }
-            emit signalMagnetometerSensorData(reply->magnetometer);
-        } else {
-            _errorText = QString("[%1] Ошибка приема ответа").arg(_methodNames.value(request->method));
-            qDebug() << _errorText;
-            return false;
         }
+        if (!pending) {
+            DRONE_LOG_WARN("Ответ на неизвестный запрос #{}", reply.request_id());
+            nn_freemsg(buf);
+            continue;
+        }
+
+        const qint64 rtt = QDateTime::currentMSecsSinceEpoch() - pending->sent_ms;
+        const bool isError = reply.status() == drone::ReplyStatus::Rejected
+                             || reply.status() == drone::ReplyStatus::Expired
+                             || reply.status() == drone::ReplyStatus::Failed;
+        // Уставки и положения цели идут десятки раз в секунду, в журнал попадают только отклонённые и просроченные
+        if (isError || !isStreamMethod(pending->method)) {
+            emit signalSendRequest(isError, QString("<-- [%1] #%2 Дрон %3: команда %4, %5 мс")
+                                                .arg(_methodNames.value(pending->method))
+                                                .arg(reply.request_id())
+                                                .arg(reply.vehicle_id())
+                                                .arg(statusNames.value(reply.status()))
+                                                .arg(rtt));
+        }
+
+        if (pending->method == drone::DroneMethods::Stats) {
+            logLatencyStats(message->payload, message->payload_size);
+        }
+        if (pending->method == drone::DroneMethods::DepthQuery) {
+            logDepthSamples(message->payload, message->payload_size);
+        }
+
+        // Показания сенсоров в UI только для выбранного дрона
+        if (!selectedVehicle) {
+            nn_freemsg(buf);
+            continue;
+        }
+        emit signalBarometerSensorData(reply.barometer());
+        emit signalImuSensorData(reply.imu());
+        const drone::GpsSensorDataRep gps = reply.gps();
+        if (gps.is_valid) {
+            emit signalGpsSensorData(gps);
+        }
+        emit signalMagnetometerSensorData(reply.magnetometer());
+        nn_freemsg(buf);
     }
+}
 
-    return true;
+drone::DroneMethodReq Controller::baseRequest(const drone::DroneMethods &method) const
+{
+    drone::DroneMethodReq request;
+    request.method = method;
+    request.speed = _speed;
+    request.yaw_is_rate = _yaw_is_rate;
+    request.yaw_or_rate = _yaw_or_rate;
+    request.drivetrain = _drivetrain;
+    // Монотонное время в мкс: возраст запроса сервер считает по этим часам
+    request.time_point = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                        std::chrono::steady_clock::now().time_since_epoch()).count());
+    request.deadline_us = _deadlines.value(method, 0);
+    request.client_session = _session;
+    request.get_camera_image = _get_image;
+    request.camera = _camera;
+    request.image_encoding = _image_encoding;
+    request.vehicle_id = _vehicle_id;
+    return request;
 }
 
 void Controller::makeRequest(const drone::DroneMethods &method)
 {
-    drone::DroneMethodReq *request = new drone::DroneMethodReq;
-    request->method = method;
-    request->speed = _speed;
-    request->yaw_is_rate = _yaw_is_rate;
-    request->yaw_or_rate = _yaw_or_rate;
-    request->drivetrain = _drivetrain;
-    request->time_point = QDateTime::currentSecsSinceEpoch();
-    request->get_camera_image = _get_image;
-    request->camera = _camera;
+    drone::DroneMethodReq *request = new drone::DroneMethodReq(baseRequest(method));
 
     if (_lastCmd != method) {
         while (!_cmqQueue.isEmpty()) {
@@ -105,15 +229,58 @@ void Controller::makeRequest(const drone::DroneMethods &method)
     }
 }
 
+bool Controller::isStreamMethod(const drone::DroneMethods &method)
+{
+    return method == drone::DroneMethods::VelocitySetpoint
+           || method == drone::DroneMethods::VisualServoTarget
+           || method == drone::DroneMethods::DepthQuery;
+}
+
+void Controller::expirePendingRequests()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<QPair<quint32, drone::DroneMethods>> lost;
+    {
+        QMutexLocker locker(&_pendingMutex);
+        for (auto it = _pendingRequests.begin(); it != _pendingRequests.end();) {
+            if (now - it->sent_ms > _replyTimeouts.value(it->method, _maneuverReplyTimeout)) {
+                lost.append({it.key(), it->method});
+                it = _pendingRequests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Потерянные уставки и запросы глубины сводятся в одну строку на команду
+    QMap<drone::DroneMethods, int> lostStream;
+    for (const auto &request : lost) {
+        if (isStreamMethod(request.second)) {
+            ++lostStream[request.second];
+            continue;
+        }
+        emit signalSendRequest(true, QString("<-- [%1] #%2 Ответ не получен")
+                                         .arg(_methodNames.value(request.second))
+                                         .arg(request.first));
+    }
+    for (auto it = lostStream.constBegin(); it != lostStream.constEnd(); ++it) {
+        emit signalSendRequest(true, QString("<-- [%1] Ответов не получено: %2")
+                                         .arg(_methodNames.value(it.key()))
+                                         .arg(it.value()));
+    }
+}
+
 void Controller::slotTimeOut()
 {
+    expirePendingRequests();
+
     if (_cmqQueue.isEmpty()) {
         return;
     }
 
      drone::DroneMethodReq *request = _cmqQueue.dequeue();
     if (sendRequest(request)) {
-        emit signalSendRequest(false, _replyText);
+        emit signalSendRequest(false, _requestText);
     } else {
         emit signalSendRequest(true, _errorText);
     }
@@ -130,6 +297,12 @@ void Controller::slotBtnCmd(const int &cmd)
 
 void Controller::slotKeyPressed(const int &key)
 {
+    if (_teleop) {
+        // Клавиша удерживается до отпускания, уставка считается по такту
+        _pressedKeys.insert(key);
+        return;
+    }
+
     switch (key) {
     case Qt::Key_Up:
         makeRequest(drone::DroneMethods::ToForward);
@@ -160,12 +333,123 @@ void Controller::slotKeyPressed(const int &key)
     }
 }
 
+void Controller::slotKeyReleased(const int &key)
+{
+    _pressedKeys.remove(key);
+}
+
+void Controller::slotSetTeleop(const bool &enabled)
+{
+    _teleop = enabled;
+    _pressedKeys.clear();
+    if (enabled) {
+        _teleopTimer->start(20);
+        qDebug() << "Непрерывное управление включено";
+    } else {
+        _teleopTimer->stop();
+        if (_teleopMoving) {
+            sendVelocitySetpoint(0.0f, 0.0f, 0.0f, 0.0f);
+            _teleopMoving = false;
+        }
+        qDebug() << "Непрерывное управление выключено";
+    }
+}
+
+void Controller::slotTeleopTimeOut()
+{
+    if (_pressedKeys.isEmpty()) {
+        // После отпускания одна нулевая уставка, дальше сервер сам переходит в зависание
+        if (_teleopMoving) {
+            sendVelocitySetpoint(0.0f, 0.0f, 0.0f, 0.0f);
+            _teleopMoving = false;
+        }
+        return;
+    }
+
+    float vx = 0.0f;
+    float vy = 0.0f;
+    float vz = 0.0f;
+    float yaw_rate = 0.0f;
+    // Скорость рысканья как у поворота по шагам
+    const float yaw_speed = _yaw_is_rate ? _yaw_or_rate : 4.0f;
+    if (_pressedKeys.contains(Qt::Key_Up)) {
+        vx += _speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_Down)) {
+        vx -= _speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_Right)) {
+        vy += _speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_Left)) {
+        vy -= _speed;
+    }
+    // Ось z направлена вниз
+    if (_pressedKeys.contains(Qt::Key_PageUp)) {
+        vz -= _speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_PageDown)) {
+        vz += _speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_Insert)) {
+        yaw_rate += yaw_speed;
+    }
+    if (_pressedKeys.contains(Qt::Key_Delete)) {
+        yaw_rate -= yaw_speed;
+    }
+
+    sendVelocitySetpoint(vx, vy, vz, yaw_rate);
+    _teleopMoving = true;
+}
+
+void Controller::sendVelocitySetpoint(const float vx, const float vy, const float vz, const float yaw_rate)
+{
+    drone::DroneMethodReq request = baseRequest(drone::DroneMethods::VelocitySetpoint);
+    request.yaw_is_rate = true;
+    request.yaw_or_rate = yaw_rate;
+    request.velocity_x = vx;
+    request.velocity_y = vy;
+    request.velocity_z = vz;
+    if (!sendRequest(&request)) {
+        emit signalSendRequest(true, _errorText);
+    }
+}
+
+void Controller::slotMissionBox()
+{
+    // Квадрат 10 x 10 м на текущей высоте, точки относительно места запуска миссии
+    constexpr float size = 10.0f;
+    const float corners[][2] = { { size, 0.0f }, { size, size }, { 0.0f, size }, { 0.0f, 0.0f } };
+
+    QByteArray payload;
+    for (const auto &corner : corners) {
+        drone::MissionWaypoint waypoint;
+        waypoint.x = corner[0];
+        waypoint.y = corner[1];
+        waypoint.velocity = _speed;
+        waypoint.drivetrain = _drivetrain;
+        waypoint.yaw_is_rate = false;
+        waypoint.relative = true;
+        payload.append(reinterpret_cast<const char*>(&waypoint), sizeof(waypoint));
+    }
+
+    // Миссия уходит сразу, не вытесняя очередь команд пульта
+    drone::DroneMethodReq request = baseRequest(drone::DroneMethods::MissionUpload);
+    if (sendRequest(&request, payload)) {
+        emit signalSendRequest(false, _requestText);
+    } else {
+        emit signalSendRequest(true, _errorText);
+    }
+}
+
 void Controller::slotSetParams(const bool &yaw_is_rate,
                                const float &yaw_or_rate,
                                const float &speed,
                                const int &drivetrain,
                                const bool &get_image,
-                               const int &camera)
+                               const int &camera,
+                               const int &image_encoding,
+                               const int &vehicle_id)
 {
     _yaw_is_rate = yaw_is_rate;
     _yaw_or_rate = yaw_or_rate;
@@ -173,6 +457,8 @@ void Controller::slotSetParams(const bool &yaw_is_rate,
     _drivetrain = drivetrain;
     _get_image = get_image;
     _camera = static_cast<DroneCamera>(camera);
+    _image_encoding = static_cast<ImageEncoding>(image_encoding);
+    _vehicle_id = static_cast<quint8>(vehicle_id);
 }
 
 void Controller::cameraImageLoop()
@@ -194,30 +480,236 @@ void Controller::cameraImageLoop()
     }
 
     qDebug() << "Приём от камеры.........";
+    quint8 frameVehicleId = _vehicle_id;
     while (_isStarted)
     {
         char *buf = NULL;
         int bytes = nn_recv(_serverSock, &buf, NN_MSG, 0);
-        if (bytes > 0) {
-            if (_isStarted) {
-                QByteArray buffer(buf, bytes);
-
-                // В GUI
-                emit signalReceivedImageData(buffer);
-                // В vlc stream
-                if (_save_images) {
-                    emit signalSaveImage(buffer);
-                }
-            }
-            nn_freemsg(buf);
+        if (bytes < 0) {
+            continue;
         }
-        else if (bytes == 0) {
+
+        const std::optional<drone::ImageFrameHeader> header =
+            drone::decodeFrameHeader(reinterpret_cast<const std::byte*>(buf), static_cast<std::size_t>(bytes));
+        if (!header) {
+            DRONE_LOG_WARN("Неверный заголовок кадра, размер: {}", bytes);
             nn_freemsg(buf);
+            continue;
+        }
+
+        // Номера кадров сквозные в пределах дрона, кадры других дронов пропускаются
+        const quint8 vehicleId = _vehicle_id;
+        if (vehicleId != frameVehicleId) {
+            frameVehicleId = vehicleId;
+            _lastFrameSequence.clear();
+            _droppedFrames.clear();
         }
+        if (_isStarted && header->vehicle_id == vehicleId
+            && checkFrameSequence(*header) && header->camera == _camera) {
+            // Изображение начинается после заголовка, неизвестный хвост заголовка пропускается
+            QByteArray buffer(buf + header->header_size, static_cast<int>(header->payload_size));
+
+            // В GUI
+            emit signalReceivedImageData(buffer, *header);
+            // В vlc stream
+            if (_save_images) {
+                emit signalSaveImage(buffer, *header);
+            }
+        }
+        nn_freemsg(buf);
     }
     qDebug() << "Окончание приёма от камеры.........";
 }
 
+bool Controller::checkFrameSequence(const drone::ImageFrameHeader &header)
+{
+    const auto last = _lastFrameSequence.constFind(header.camera);
+    if (last != _lastFrameSequence.constEnd()) {
+        if (header.sequence <= last.value()) {
+            return false;
+        }
+        const quint64 gap = header.sequence - last.value() - 1;
+        if (gap > 0) {
+            _droppedFrames[header.camera] += gap;
+            DRONE_LOG_DEBUG("Пропущено кадров камеры {}: {} всего: {}", header.camera, gap, _droppedFrames.value(header.camera));
+        }
+    }
+    _lastFrameSequence[header.camera] = header.sequence;
+    return true;
+}
+
+void Controller::telemetryLoop()
+{
+    _telemetrySock = nn_socket(AF_SP, NN_SUB);
+    if (_telemetrySock < 0) {
+        qDebug() << "Ошибка инициализации socket телеметрии";
+        return;
+    }
+
+    if (nn_setsockopt(_telemetrySock, NN_SUB, NN_SUB_SUBSCRIBE, "", 0) < 0) {
+        qDebug() << "Ошибка подписки на телеметрию";
+    }
+
+    int to = 100;
+    if (nn_setsockopt(_telemetrySock, NN_SOL_SOCKET, NN_RCVTIMEO, &to, sizeof(to)) < 0) {
+        qDebug() << "Ошибка set socket options";
+    }
+
+    if (nn_connect(_telemetrySock, "tcp://127.0.0.1:20003") < 0) {
+        qDebug() << "Ошибка соединения с сервером телеметрии";
+        nn_close(_telemetrySock);
+        return;
+    }
+
+    constexpr int headerSize = static_cast<int>(sizeof(drone::TelemetrySampleHeader));
+    while (_isStarted)
+    {
+        char *buf = NULL;
+        int bytes = nn_recv(_telemetrySock, &buf, NN_MSG, 0);
+        if (bytes < 0) {
+            continue;
+        }
+
+        const drone::TelemetrySampleHeader *header = reinterpret_cast<const drone::TelemetrySampleHeader*>(buf);
+        const char *payload = buf + headerSize;
+        const int payloadSize = bytes - headerSize;
+        if (bytes >= headerSize && _isStarted && header->vehicle_id == _vehicle_id) {
+            switch (header->sensor) {
+            case drone::DroneSensors::Barometer:
+                if (payloadSize >= static_cast<int>(sizeof(BarometerSensorDataRep))) {
+                    emit signalBarometerSensorData(*reinterpret_cast<const BarometerSensorDataRep*>(payload));
+                }
+                break;
+            case drone::DroneSensors::Imu:
+                if (payloadSize >= static_cast<int>(sizeof(ImuSensorDataRep))) {
+                    emit signalImuSensorData(*reinterpret_cast<const ImuSensorDataRep*>(payload));
+                }
+                break;
+            case drone::DroneSensors::Gps:
+                if (payloadSize >= static_cast<int>(sizeof(GpsSensorDataRep))) {
+                    const GpsSensorDataRep *gps = reinterpret_cast<const GpsSensorDataRep*>(payload);
+                    if (gps->is_valid) {
+                        emit signalGpsSensorData(*gps);
+                    }
+                }
+                break;
+            case drone::DroneSensors::Magnetometer:
+                if (payloadSize >= static_cast<int>(sizeof(MagnetometerSensorDataRep))) {
+                    emit signalMagnetometerSensorData(*reinterpret_cast<const MagnetometerSensorDataRep*>(payload));
+                }
+                break;
+            case drone::DroneSensors::MissionProgress:
+                if (payloadSize >= static_cast<int>(sizeof(MissionProgressRep))) {
+                    logMissionProgress(*reinterpret_cast<const MissionProgressRep*>(payload));
+                }
+                break;
+            }
+        }
+        nn_freemsg(buf);
+    }
+    nn_close(_telemetrySock);
+    _telemetrySock = -1;
+}
+
+void Controller::logMissionProgress(const drone::MissionProgressRep &progress)
+{
+    // Ход миссии приходит 10 раз в секунду, в журнал - только смена точки или состояния
+    if (progress.mission_id == _lastMissionProgress.mission_id
+        && progress.state == _lastMissionProgress.state
+        && progress.waypoint_index == _lastMissionProgress.waypoint_index) {
+        return;
+    }
+    _lastMissionProgress = progress;
+
+    const QMap<drone::MissionState, QString> stateNames = {
+        {drone::MissionState::Idle, "ожидание"},
+        {drone::MissionState::Running, "выполняется"},
+        {drone::MissionState::Paused, "пауза"},
+        {drone::MissionState::Completed, "завершена"},
+        {drone::MissionState::Aborted, "прервана"},
+        {drone::MissionState::Preempted, "вытеснена"},
+        {drone::MissionState::Failed, "ошибка"}
+    };
+    const bool isError = progress.state == drone::MissionState::Failed;
+    emit signalSendRequest(isError, QString("<-- Миссия #%1: %2, точка %3 из %4, %5 м")
+                                        .arg(progress.mission_id)
+                                        .arg(stateNames.value(progress.state))
+                                        .arg(progress.waypoint_index + 1)
+                                        .arg(progress.waypoint_count)
+                                        .arg(progress.distance, 0, 'f', 1));
+}
+
+void Controller::logLatencyStats(const std::byte *payload, const std::size_t size)
+{
+    const QMap<drone::LatencyStage, QString> stageNames = {
+        {drone::LatencyStage::QueueWait, "очередь"},
+        {drone::LatencyStage::Dispatch, "разбор"},
+        {drone::LatencyStage::Execution, "AirSim"},
+        {drone::LatencyStage::ReplyWait, "отправка"},
+        {drone::LatencyStage::Total, "всего"},
+        {drone::LatencyStage::FrameCapture, "захват"},
+        {drone::LatencyStage::FrameSend, "отправка"},
+        {drone::LatencyStage::RequestAge, "возраст выполненных"},
+        {drone::LatencyStage::Expired, "просрочено"},
+        {drone::LatencyStage::ReplyDropped, "ответ не отправлен"}
+    };
+
+    const std::size_t count = size / sizeof(drone::LatencyStatsRep);
+    emit signalSendRequest(false, QString("<-- Статистика сервера, записей: %1").arg(count));
+    for (std::size_t i = 0; i < count; ++i) {
+        drone::LatencyStatsRep entry;
+        std::memcpy(&entry, payload + i * sizeof(entry), sizeof(entry));
+        QString source = QString::number(entry.id);
+        if (entry.source == drone::LatencySource::Camera) {
+            const auto camera = drone::map_cameras.find(static_cast<drone::DroneCamera>(entry.id));
+            if (camera != drone::map_cameras.end()) {
+                source = QString::fromStdString(camera->second);
+            }
+        }
+        else {
+            source = _methodNames.value(static_cast<drone::DroneMethods>(entry.id), source);
+        }
+        emit signalSendRequest(false, QString("    [%1] %2: n=%3, p50 %4 мкс, p99 %5 мкс, max %6 мкс")
+                                          .arg(source)
+                                          .arg(stageNames.value(entry.stage))
+                                          .arg(entry.count)
+                                          .arg(entry.p50_us)
+                                          .arg(entry.p99_us)
+                                          .arg(entry.max_us));
+    }
+}
+
+void Controller::sendDepthQuery(const float target_x, const float target_y)
+{
+    // Окно 9 x 9 пикселей вокруг цели, медиана устойчива к краю объекта
+    drone::DepthRoiReq roi;
+    roi.x = target_x;
+    roi.y = target_y;
+    roi.half_size = 4;
+    roi.estimator = drone::DepthEstimator::Median;
+    const QByteArray payload(reinterpret_cast<const char*>(&roi), sizeof(roi));
+
+    drone::DroneMethodReq request = baseRequest(drone::DroneMethods::DepthQuery);
+    if (!sendRequest(&request, payload)) {
+        emit signalSendRequest(true, _errorText);
+    }
+}
+
+void Controller::logDepthSamples(const std::byte *payload, const std::size_t size)
+{
+    const std::size_t count = size / sizeof(drone::DepthSampleRep);
+    for (std::size_t i = 0; i < count; ++i) {
+        drone::DepthSampleRep sample;
+        std::memcpy(&sample, payload + i * sizeof(sample), sizeof(sample));
+        if (sample.valid) {
+            DRONE_LOG_DEBUG("Цель {}: расстояние {} м, глубина {} м, пикселей {}", i, sample.distance, sample.depth, sample.pixels);
+        }
+        else {
+            DRONE_LOG_DEBUG("Цель {}: глубина недостоверна", i);
+        }
+    }
+}
+
 void Controller::slotSetSaveParams(const bool &save_images, const bool &save_sensors_data)
 {
     _save_images = save_images;
@@ -230,44 +722,23 @@ void Controller::slotAiDataResponse(const QPoint &obj,
                                     const double &polar_r,
                                     const double &polar_theta)
 {
-    qDebug() << "Коррекция на центр < > /\\ \\/...., размер:" << size;
-
     Q_UNUSED(polar_r);
     Q_UNUSED(polar_theta);
 
-    constexpr int delta_x = 40;
-    constexpr int delta_y = 40;
-
-    int res_x = center.x() - obj.x();
-    int res_y = center.y() - obj.y();
-
-    if (std::abs(res_x) > delta_x) {
-        // Нужен корректирующий поворот
-        _yaw_is_rate = true;
-        std::abs(res_x) > (delta_x * 3) ? _yaw_or_rate = 6.0f : _yaw_or_rate = 2.0f;
-        if (res_x < 0) {
-            // Объект слева, поворот влево
-            makeRequest(drone::DroneMethods::RotateLeft);
-            qDebug() << "<=== Влево, delta:" << std::abs(res_x);
-        } else if (res_x > 0) {
-            // Объект справа, поворот вправо
-            makeRequest(drone::DroneMethods::RotateRight);
-            qDebug() << "===> Вправо, delta:" << std::abs(res_x);
-        }
-    } else if (std::abs(res_y) > delta_y) {
-        // Нужен корректирующий спуск/подъём
-        if (res_y > 0) {
-            // Объект сверху, подъём
-            makeRequest(drone::DroneMethods::ToUp);
-            qDebug() << "/ \\";
-            qDebug() << " |";
-            qDebug() << " | Вверх";
-        } else if (res_y < 0) {
-            // Объект снизу, спуск
-            makeRequest(drone::DroneMethods::ToDown);
-            qDebug() << " |";
-            qDebug() << " |";
-            qDebug() << "\\ / Вниз";
-        }
+    if (size.width() <= 0 || size.height() <= 0) {
+        return;
     }
+
+    // Регулятор работает на сервере: отправляется только смещение цели от центра,
+    // нормированное на половину кадра, без очереди команд
+    drone::DroneMethodReq request = baseRequest(drone::DroneMethods::VisualServoTarget);
+    request.target_x = static_cast<float>(obj.x() - center.x()) / (size.width() / 2.0f);
+    request.target_y = static_cast<float>(obj.y() - center.y()) / (size.height() / 2.0f);
+    if (!sendRequest(&request)) {
+        emit signalSendRequest(true, _errorText);
+    }
+
+    // Расстояние до цели в той же нормировке; запросы в пределах срока жизни
+    // кадра глубины на сервере используют один снимок AirSim
+    sendDepthQuery(request.target_x, request.target_y);
 }
@@ -9,8 +9,13 @@
 #include <QQueue>
 #include <QTimer>
 #include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
 #include <QSharedPointer>
+#include <QRandomGenerator>
 #include "../ControllDroneServer/DroneRpc.hpp"
+#include "../ControllDroneServer/DroneWire.hpp"
 
 using namespace drone;
 
@@ -24,9 +29,9 @@ class Controller : public QObject
 private:
     int _clientSock = -1;
     int _serverSock = -1;
+    int _telemetrySock = -1;
     QString _errorText;
     QString _requestText;
-    QString _replyText;
     QQueue<drone::DroneMethodReq*> _cmqQueue;
     drone::DroneMethods _lastCmd = drone::DroneMethods::Wait;
     QMap<drone::DroneMethods, QString> _methodNames = {
@@ -47,10 +52,43 @@ private:
         {drone::DroneMethods::ToForward, "ToForward"},
         {drone::DroneMethods::ToBack, "ToBack"},
         {drone::DroneMethods::RotateLeft, "RotateLeft"},
-        {drone::DroneMethods::RotateRight, "RotateRight"}
+        {drone::DroneMethods::RotateRight, "RotateRight"},
+        {drone::DroneMethods::VelocitySetpoint, "VelocitySetpoint"},
+        {drone::DroneMethods::MissionUpload, "MissionUpload"},
+        {drone::DroneMethods::MissionPause, "MissionPause"},
+        {drone::DroneMethods::MissionResume, "MissionResume"},
+        {drone::DroneMethods::MissionAbort, "MissionAbort"},
+        {drone::DroneMethods::VisualServoTarget, "VisualServoTarget"},
+        {drone::DroneMethods::VisualServoStop, "VisualServoStop"},
+        {drone::DroneMethods::Stats, "Stats"},
+        {drone::DroneMethods::DepthQuery, "DepthQuery"}
+    };
+    // Срок действия запросов, мкс: устаревшие команды движения сервер не выполняет.
+    // Остальные команды, в том числе посадка, без срока
+    QMap<drone::DroneMethods, quint32> _deadlines = {
+        {drone::DroneMethods::ToUp, 1000000},
+        {drone::DroneMethods::ToDown, 1000000},
+        {drone::DroneMethods::ToRight, 1000000},
+        {drone::DroneMethods::ToLeft, 1000000},
+        {drone::DroneMethods::ToForward, 1000000},
+        {drone::DroneMethods::ToBack, 1000000},
+        {drone::DroneMethods::RotateLeft, 1000000},
+        {drone::DroneMethods::RotateRight, 1000000},
+        // Уставки и положения цели обновляются десятки раз в секунду
+        {drone::DroneMethods::VelocitySetpoint, 200000},
+        {drone::DroneMethods::VisualServoTarget, 200000}
     };
     QSharedPointer<QTimer> _timer;
+    // Непрерывное управление: опрос удерживаемых клавиш с постоянной частотой
+    QSharedPointer<QTimer> _teleopTimer;
+    bool _teleop = false;
+    bool _teleopMoving = false; // последняя отправленная уставка ненулевая
+    QSet<int> _pressedKeys;
+    // Последний записанный в журнал ход миссии (поток телеметрии)
+    drone::MissionProgressRep _lastMissionProgress;
     QFuture<void> _future;      // результат работы потока
+    QFuture<void> _futureTelemetry; // результат работы потока телеметрии
+    QFuture<void> _futureReply; // результат работы потока приёма ответов
     std::atomic<bool> _isStarted {true};
 
     // Параметры запроса из Ui
@@ -60,9 +98,42 @@ private:
     int _drivetrain = 1;
     bool _get_image = false;
     DroneCamera _camera = DroneCamera::front_center;
+    ImageEncoding _image_encoding = ImageEncoding::Jpeg;
+    // Номер дрона на сервере: команды, телеметрия и кадры только этого дрона
+    std::atomic<quint8> _vehicle_id {0};
     // Сохранеие  данных с дрона
     bool _save_images = false;
     bool _save_sensors_data = false;    
+    // Приём кадров: последний номер кадра и число пропусков по камерам
+    QMap<drone::DroneCamera, quint64> _lastFrameSequence;
+    QMap<drone::DroneCamera, quint64> _droppedFrames;
+    // Отправленные запросы, ожидающие ответа, по идентификатору запроса
+    struct PendingRequest
+    {
+        drone::DroneMethods method;
+        qint64 sent_ms;
+    };
+    QHash<quint32, PendingRequest> _pendingRequests;
+    QMutex _pendingMutex;
+    // Ожидание ответа, мс: после него запрос считается потерянным. Манёвры и
+    // миссии отвечают по завершении, остальные команды - сразу
+    QMap<drone::DroneMethods, qint64> _replyTimeouts = {
+        {drone::DroneMethods::VelocitySetpoint, 5000},
+        {drone::DroneMethods::VisualServoTarget, 5000},
+        {drone::DroneMethods::DepthQuery, 5000},
+        {drone::DroneMethods::Stats, 5000},
+        {drone::DroneMethods::BarometerData, 5000},
+        {drone::DroneMethods::ImuData, 5000},
+        {drone::DroneMethods::GpsData, 5000},
+        {drone::DroneMethods::MagnetometerData, 5000},
+        {drone::DroneMethods::MissionPause, 5000},
+        {drone::DroneMethods::MissionResume, 5000},
+        {drone::DroneMethods::MissionAbort, 5000}
+    };
+    qint64 _maneuverReplyTimeout = 600000;
+    quint32 _nextRequestId = 0;
+    // Номер запуска клиента: сервер ведёт по нему оценку часов клиента
+    const quint64 _session = QRandomGenerator::system()->generate64() | 1;
 
 public:
     explicit Controller(QObject *parent = nullptr);
@@ -75,23 +146,83 @@ public:
     bool setInit();
 
 private:
+    /// <summary>
+    /// Запрос с текущими параметрами из Ui
+    /// </summary>
+    drone::DroneMethodReq baseRequest(const drone::DroneMethods &method) const;
+
     /// <summary>
     /// Создание структуры запроса к дрону и постановка в очередь
     /// </summary>
     void makeRequest(const drone::DroneMethods &method);
 
     /// <summary>
-    /// Отправка запроса и удаление из очереди
+    /// Отправка запроса без ожидания ответа
     /// </summary>
     /// <param name="request">Указатель на запрос к дрону</param>
+    /// <param name="payload">Данные после тела запроса, например маршрут миссии</param>
     /// <returns>Результат выполнения отправки по сети</returns>
-    bool sendRequest(drone::DroneMethodReq *request);
+    bool sendRequest(drone::DroneMethodReq *request, const QByteArray &payload = QByteArray());
+
+    /// <summary>
+    /// Цикл приёма ответов сервера, ответы приходят в порядке завершения команд
+    /// </summary>
+    void replyLoop();
+
+    /// <summary>
+    /// Отправка уставки скорости по удерживаемым клавишам
+    /// </summary>
+    void sendVelocitySetpoint(const float vx, const float vy, const float vz, const float yaw_rate);
 
     /// <summary>
     /// Цикл приёма изображения от камеры
     /// </summary>
     void cameraImageLoop();
 
+    /// <summary>
+    /// Учёт пропущенных кадров камеры по номеру кадра
+    /// </summary>
+    /// <returns>false, если кадр устарел и пришёл после более нового</returns>
+    bool checkFrameSequence(const drone::ImageFrameHeader &header);
+
+    /// <summary>
+    /// Цикл приёма телеметрии, публикуемой сервером
+    /// </summary>
+    void telemetryLoop();
+
+    /// <summary>
+    /// Запись хода миссии в журнал UI
+    /// </summary>
+    void logMissionProgress(const drone::MissionProgressRep &progress);
+
+    /// <summary>
+    /// Запись статистики задержек сервера в журнал UI
+    /// </summary>
+    /// <param name="payload">Массив записей из данных ответа Stats</param>
+    void logLatencyStats(const std::byte *payload, const std::size_t size);
+
+    /// <summary>
+    /// Запрос расстояния до цели AI: глубина по области вокруг цели в кадре
+    /// </summary>
+    void sendDepthQuery(const float target_x, const float target_y);
+
+    /// <summary>
+    /// Запись расстояний до целей в журнал
+    /// </summary>
+    /// <param name="payload">Массив оценок из данных ответа DepthQuery</param>
+    void logDepthSamples(const std::byte *payload, const std::size_t size);
+
+    /// <summary>
+    /// Команды, которые отправляются десятки раз в секунду и попадают в журнал
+    /// только при ошибке
+    /// </summary>
+    static bool isStreamMethod(const drone::DroneMethods &method);
+
+    /// <summary>
+    /// Удаление запросов, ответ на которые не пришёл за время ожидания
+    /// </summary>
+    void expirePendingRequests();
+
 public slots:
     /// <summary>
     /// Создание запросов к дрону
@@ -105,6 +236,22 @@ public slots:
     /// <param name="key">Код нажатой клавиши</param>
     void slotKeyPressed(const int &key);
 
+    /// <summary>
+    /// Отпускание клавиш в непрерывном режиме
+    /// </summary>
+    /// <param name="key">Код отпущенной клавиши</param>
+    void slotKeyReleased(const int &key);
+
+    /// <summary>
+    /// Включение/выключение непрерывного управления
+    /// </summary>
+    void slotSetTeleop(const bool &enabled);
+
+    /// <summary>
+    /// Загрузка тестовой миссии: облёт квадрата на сервере
+    /// </summary>
+    void slotMissionBox();
+
     /// <summary>
     /// Установка параметров запроса
     /// </summary>
@@ -113,7 +260,9 @@ public slots:
                        const float &speed,
                        const int &drivetrain,
                        const bool &get_image,
-                       const int &camera);
+                       const int &camera,
+                       const int &image_encoding,
+                       const int &vehicle_id);
 
     /// <summary>
     /// Установка параметров сохранения
@@ -135,6 +284,11 @@ private slots:
     /// </summary>
     void slotTimeOut();
 
+    /// <summary>
+    /// Такт непрерывного управления
+    /// </summary>
+    void slotTeleopTimeOut();
+
 signals:
     /// <summary>
     /// Отправка в UI результата выполнения сетевой посылки запроса
@@ -166,14 +320,19 @@ signals:
     /// <summary>
     /// Сигнал отправляет изображение, принятое через nanomsg
     /// </summary>
-    void signalReceivedImageData(const QByteArray &buffer);
+    /// <param name="buffer">Изображение без заголовка</param>
+    /// <param name="header">Заголовок кадра</param>
+    void signalReceivedImageData(const QByteArray &buffer, const drone::ImageFrameHeader &header);
 
     /// <summary>
     /// Сигнал отправляет изображение для сохранения или отображения
     /// </summary>
-    void signalSaveImage(const QByteArray &buffer);
+    void signalSaveImage(const QByteArray &buffer, const drone::ImageFrameHeader &header);
 
 };
 
+// Заголовок кадра передаётся через очередь между потоками под полным именем
+Q_DECLARE_METATYPE(drone::ImageFrameHeader)
+
 
 #endif // CONTROLLER_H
@@ -14,15 +14,19 @@ INCLUDEPATH += ../AirLib/include
 SOURCES += \
     Application/application.cpp \
     Controller/controller.cpp \
+    FrameDecoder/framedecoder.cpp \
     ImageServer/imageserver.cpp \
     MainWindow/mainwindow.cpp \
     MjpegStreamer/mjpegstreamer.cpp \
     main.cpp
 
 HEADERS += \
+    ../ControllDroneServer/AsyncLog.hpp \
     ../ControllDroneServer/DroneRpc.hpp \
+    ../ControllDroneServer/DroneWire.hpp \
     Application/application.h \
     Controller/controller.h \
+    FrameDecoder/framedecoder.h \
     ImageServer/imageserver.h \
     MainWindow/mainwindow.h \
     MjpegStreamer/mjpegstreamer.h
@@ -35,11 +39,16 @@ win32 {
     INCLUDEPATH += $$PWD/../../../msys64/ucrt64/include
 
     LIBS += c:/msys64/ucrt64/lib/libnng.dll.a
+    LIBS += c:/msys64/ucrt64/lib/liblz4.dll.a
     LIBS += c:/Windows/System32/msvcrt.dll
     LIBS += -lws2_32
 
 } unix {
     LIBS += -lnanomsg
+    LIBS += -llz4
 }
 
+# SIMD преобразование пикселей в FrameDecoder
+*-g++*: QMAKE_CXXFLAGS += -mssse3
+
 #DEFINES += SAVE_IMAGES
@@ -0,0 +1,87 @@
+#include <QBuffer>
+#include <lz4.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#include "framedecoder.h"
+#include "../ControllDroneServer/AsyncLog.hpp"
+
+QImage FrameDecoder::decode(const QByteArray &buffer, const drone::ImageFrameHeader &header)
+{
+    const int width = static_cast<int>(header.width);
+    const int height = static_cast<int>(header.height);
+    const int rawSize = width * height * 3;
+
+    switch (header.encoding) {
+    case drone::ImageEncoding::Png:
+        return QImage::fromData(buffer, "PNG");
+    case drone::ImageEncoding::Jpeg:
+        return QImage::fromData(buffer, "JPEG");
+    case drone::ImageEncoding::Bgr8: {
+        if (buffer.size() != rawSize) {
+            DRONE_LOG_WARN("Неверный размер кадра BGR: {}", buffer.size());
+            return QImage();
+        }
+        QImage image(width, height, QImage::Format_RGB32);
+        for (int y = 0; y < height; ++y) {
+            bgrToRgb32(reinterpret_cast<const uchar*>(buffer.constData()) + y * width * 3, image.scanLine(y), width);
+        }
+        return image;
+    }
+    case drone::ImageEncoding::Lz4Bgr: {
+        // Буфер распаковки переиспользуется между кадрами потока
+        thread_local QByteArray raw;
+        raw.resize(rawSize);
+        const int bytes = LZ4_decompress_safe(buffer.constData(), raw.data(), buffer.size(), rawSize);
+        if (bytes != rawSize) {
+            DRONE_LOG_WARN("Ошибка распаковки кадра LZ4: {}", bytes);
+            return QImage();
+        }
+        QImage image(width, height, QImage::Format_RGB32);
+        for (int y = 0; y < height; ++y) {
+            bgrToRgb32(reinterpret_cast<const uchar*>(raw.constData()) + y * width * 3, image.scanLine(y), width);
+        }
+        return image;
+    }
+    }
+    return QImage();
+}
+
+QByteArray FrameDecoder::toJpeg(const QByteArray &buffer, const drone::ImageFrameHeader &header)
+{
+    if (header.encoding == drone::ImageEncoding::Jpeg) {
+        return buffer;
+    }
+
+    const QImage image = decode(buffer, header);
+    QByteArray jpeg;
+    QBuffer qbuf(&jpeg);
+    qbuf.open(QIODevice::WriteOnly);
+    if (image.isNull() || !image.save(&qbuf, "JPEG")) {
+        return QByteArray();
+    }
+    return jpeg;
+}
+
+void FrameDecoder::bgrToRgb32(const uchar *src, uchar *dst, int pixels)
+{
+    // Format_RGB32 в памяти хранится как B, G, R, 0xFF
+    int i = 0;
+#if defined(__SSSE3__)
+    // 4 пикселя за шаг: 12 байт BGR раскладываются в 16 байт BGRA
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    // Загрузка 16 байт: последний шаг останавливается так, чтобы не читать за концом строки
+    for (; i + 6 <= pixels; i += 4) {
+        const __m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        const __m128i bgra = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), bgra);
+    }
+#endif
+    for (; i < pixels; ++i) {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 0xFF;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include "../ControllDroneServer/DroneRpc.hpp"
+
+/// <summary>
+/// Декодирование кадров камеры в QImage по кодированию из заголовка кадра
+/// </summary>
+class FrameDecoder
+{
+public:
+    /// <summary>
+    /// Декодирование кадра
+    /// </summary>
+    /// <param name="buffer">Изображение без заголовка</param>
+    /// <param name="header">Заголовок кадра</param>
+    /// <returns>Изображение, пустое при ошибке</returns>
+    static QImage decode(const QByteArray &buffer, const drone::ImageFrameHeader &header);
+
+    /// <summary>
+    /// Перекодирование кадра в JPEG, кадры JPEG возвращаются без изменений
+    /// </summary>
+    /// <param name="buffer">Изображение без заголовка</param>
+    /// <param name="header">Заголовок кадра</param>
+    /// <returns>JPEG, пустой массив при ошибке</returns>
+    static QByteArray toJpeg(const QByteArray &buffer, const drone::ImageFrameHeader &header);
+
+    /// <summary>
+    /// Преобразование пикселей BGR (3 байта) в формат QImage::Format_RGB32
+    /// </summary>
+    static void bgrToRgb32(const uchar *src, uchar *dst, int pixels);
+};
+
+#endif // FRAME_DECODER_H
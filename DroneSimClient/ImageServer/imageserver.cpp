@@ -10,6 +10,8 @@
 #include <asio.hpp>
 #include <nlohmann/json.hpp>
 #include "imageserver.h"
+#include "FrameDecoder/framedecoder.h"
+#include "../ControllDroneServer/AsyncLog.hpp"
 
 using namespace std::literals::chrono_literals;
 using json = nlohmann::json;
@@ -68,40 +70,32 @@ ImageServer::~ImageServer()
     }
 }
 
-void ImageServer::slotSave(const QByteArray &buffer)
+void ImageServer::slotSave(const QByteArray &buffer, const drone::ImageFrameHeader &header)
 {
     if (!_futureConnect.isRunning() && !_isConnectedToAi) {
         _futureConnect = QtConcurrent::run(this, &ImageServer::connectToAi);
         qDebug() << "Попытка соединения с AI сервисом";
     }
 
-    if (_isConnectedToAi && !_futureSendImage.isRunning()) {
-        _futureSendImage = QtConcurrent::run(this, &ImageServer::sendImageToAi, buffer);
-        _isStarted = true;
-        qDebug() << "Отправка изображения в AI сервис";
-    }
-
     if (_isConnectedToAi && !_futureResponse.isRunning()) {
         _futureResponse = QtConcurrent::run(this, &ImageServer::responseFromAi);
         qDebug() << "Запуск приёма json от AI сервиса";
     }
 
-    QPixmap pixmap;
-    pixmap.loadFromData(buffer);
-    QImage image = pixmap.toImage();
-
-    // Создаем массив байтов для хранения результата в формате JPEG
-    QByteArray baJpeg;
-    QBuffer qbuf(&baJpeg);
-    qbuf.open(QIODevice::WriteOnly);
-
-    // Сохраняем изображение в буфер в формате JPEG
-    bool success = image.save(&qbuf, "JPEG");
-    if (!success) {
-        qWarning() << "Ошибка сохранения изображения в JPEG";
+    // Кадры JPEG уходят без перекодирования, остальные кодируются в JPEG здесь
+    const QByteArray baJpeg = FrameDecoder::toJpeg(buffer, header);
+    if (baJpeg.isEmpty()) {
+        DRONE_LOG_WARN("Ошибка сохранения изображения в JPEG");
         return;
     }
 
+    // В AI отправляется JPEG: сырые кадры BGR/LZ4 сервис не декодирует
+    if (_isConnectedToAi && !_futureSendImage.isRunning()) {
+        _futureSendImage = QtConcurrent::run(this, &ImageServer::sendImageToAi, baJpeg);
+        _isStarted = true;
+        DRONE_LOG_DEBUG("Отправка изображения в AI сервис");
+    }
+
     // Отправка кадра в видео поток
     emit signalShowImage(baJpeg);
 
@@ -148,7 +142,7 @@ void ImageServer::responseFromAi()
             double polar_r = data["polar_coordinates"]["r_px"];
             double polar_theta = data["polar_coordinates"]["theta_deg"];
 
-            qDebug() << "Ответ от AI";
+            DRONE_LOG_DEBUG("Ответ от AI: цель ({}, {}), r {}, theta {}", object_x, object_y, polar_r, polar_theta);
             emit signalAiDataResponse(QPoint(object_x, object_y),
                                       QPoint(center_x, center_y),
                                       QSize(width, height),
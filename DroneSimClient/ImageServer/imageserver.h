@@ -9,6 +9,7 @@
 #include <QSize>
 #include <atomic>
 #include "MjpegStreamer/mjpegstreamer.h"
+#include "../ControllDroneServer/DroneRpc.hpp"
 
 // --- Структуры форматов ---
 
@@ -100,7 +101,8 @@ public slots:
     /// Создание запросов к дрону
     /// </summary>
     /// <param name="buffer">Кадр</param>
-    void slotSave(const QByteArray &buffer);
+    /// <param name="header">Заголовок кадра</param>
+    void slotSave(const QByteArray &buffer, const drone::ImageFrameHeader &header);
 
 signals:
     /// <summary>
@@ -2,6 +2,7 @@
 #include <QKeyEvent>
 #include <QImageReader>
 #include "mainwindow.h"
+#include "FrameDecoder/framedecoder.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -62,6 +63,15 @@ void MainWindow::keyPressEvent(QKeyEvent* event)
     }
 }
 
+void MainWindow::keyReleaseEvent(QKeyEvent* event)
+{
+    // Автоповтор присылает пары нажатие/отпускание, клавиша при этом удерживается
+    if (event->isAutoRepeat()) {
+        return;
+    }
+    emit signalKeyReleased(event->key());
+}
+
 void MainWindow::slotTimeOut()
 {
     DroneCamera camera = DroneCamera::front_center;
@@ -82,7 +92,9 @@ void MainWindow::slotTimeOut()
                          sbSpeed->value(),
                          cBoxDrivetrainType->currentIndex(),
                          cBoxGetImage->isChecked(),
-                         static_cast<int>(camera));
+                         static_cast<int>(camera),
+                         cBoxImageEncoding->currentIndex(),
+                         sbVehicleId->value());
 }
 
 void MainWindow::setController(Controller *controller)
@@ -117,27 +129,57 @@ void MainWindow::setController(Controller *controller)
     connect(pBtnTestBox, &QPushButton::clicked, this, [this]() {
         emit signalBtnCmd(static_cast<int>(drone::DroneMethods::TestFlyBox));
     }, Qt::QueuedConnection);
-    // Пульт управления
-    connect(pBtnUp, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToUp));
+    connect(pBtnStats, &QPushButton::clicked, this, [this]() {
+        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::Stats));
     }, Qt::QueuedConnection);
-    connect(pBtnDown, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToDown));
+    // Миссия
+    connect(this, &MainWindow::signalMissionBox,
+            controller, &Controller::slotMissionBox, Qt::QueuedConnection);
+    connect(pBtnMissionBox, &QPushButton::clicked, this, [this]() {
+        emit signalMissionBox();
     }, Qt::QueuedConnection);
-    connect(pBtnForward, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToForward));
+    connect(pBtnMissionPause, &QPushButton::clicked, this, [this]() {
+        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::MissionPause));
     }, Qt::QueuedConnection);
-    connect(pBtnBack, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToBack));
+    connect(pBtnMissionResume, &QPushButton::clicked, this, [this]() {
+        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::MissionResume));
     }, Qt::QueuedConnection);
-    connect(pBtnRight, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToRight));
-    }, Qt::QueuedConnection);
-    connect(pBtnLeft, &QPushButton::clicked, this, [this]() {
-        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::ToLeft));
+    connect(pBtnMissionAbort, &QPushButton::clicked, this, [this]() {
+        emit signalBtnCmd(static_cast<int>(drone::DroneMethods::MissionAbort));
     }, Qt::QueuedConnection);
+    // Пульт управления: щелчок - шаг на метр,
+    // в непрерывном режиме кнопка удерживается как соответствующая клавиша
+    const auto connectPadButton = [this](QPushButton *button, const drone::DroneMethods method, const int key) {
+        connect(button, &QPushButton::clicked, this, [this, method]() {
+            if (!cBoxTeleop->isChecked()) {
+                emit signalBtnCmd(static_cast<int>(method));
+            }
+        }, Qt::QueuedConnection);
+        connect(button, &QPushButton::pressed, this, [this, key]() {
+            if (cBoxTeleop->isChecked()) {
+                emit signalKeyPressed(key);
+            }
+        });
+        connect(button, &QPushButton::released, this, [this, key]() {
+            emit signalKeyReleased(key);
+        });
+    };
+    connectPadButton(pBtnUp, drone::DroneMethods::ToUp, Qt::Key_PageUp);
+    connectPadButton(pBtnDown, drone::DroneMethods::ToDown, Qt::Key_PageDown);
+    connectPadButton(pBtnForward, drone::DroneMethods::ToForward, Qt::Key_Up);
+    connectPadButton(pBtnBack, drone::DroneMethods::ToBack, Qt::Key_Down);
+    connectPadButton(pBtnRight, drone::DroneMethods::ToRight, Qt::Key_Right);
+    connectPadButton(pBtnLeft, drone::DroneMethods::ToLeft, Qt::Key_Left);
     connect(this, &MainWindow::signalKeyPressed,
             controller, &Controller::slotKeyPressed, Qt::QueuedConnection);
+    connect(this, &MainWindow::signalKeyReleased,
+            controller, &Controller::slotKeyReleased, Qt::QueuedConnection);
+    connect(this, &MainWindow::signalSetTeleop,
+            controller, &Controller::slotSetTeleop, Qt::QueuedConnection);
+    connect(cBoxTeleop, &QCheckBox::stateChanged,
+            this, [this](int) {
+        emit signalSetTeleop(cBoxTeleop->isChecked());
+    }, Qt::QueuedConnection);
     // Сенсоры
     connect(controller, &Controller::signalBarometerSensorData,
             this, &MainWindow::slotBarometerSensorData, Qt::QueuedConnection);
@@ -243,11 +285,18 @@ void MainWindow::slotMagnetometerSensorData(const MagnetometerSensorDataRep &dat
     twMagnetometer->item(2, 1)->setText(QString::number(data.z, 'f', 2));
 }
 
-void MainWindow::slotReceivedImageData(const QByteArray &buffer)
+void MainWindow::slotReceivedImageData(const QByteArray &buffer, const drone::ImageFrameHeader &header)
 {
-    QPixmap pixmap;
-    pixmap.loadFromData(buffer);
-    labelImage->setPixmap(pixmap.scaled(QSize(640, 320)));
+    const QImage image = FrameDecoder::decode(buffer, header);
+    if (image.isNull()) {
+        return;
+    }
+    labelImage->setPixmap(QPixmap::fromImage(image).scaled(QSize(640, 320)));
     _image_counter++;
-    statusbar->showMessage("Images: " + QString::number(_image_counter));
+    // Задержка от захвата в AirSim до отображения
+    const qint64 latencyMs = QDateTime::currentMSecsSinceEpoch() - static_cast<qint64>(header.time_stamp / 1000000);
+    statusbar->showMessage(QString("Images: %1  Frame: %2  Latency: %3 ms")
+                           .arg(_image_counter)
+                           .arg(header.sequence)
+                           .arg(latencyMs));
 }
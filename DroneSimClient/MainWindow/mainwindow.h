@@ -56,7 +56,7 @@ public slots:
     /// <summary>
     /// Сигнал отправляет изображение, принятое через nanomsg
     /// </summary>
-    void slotReceivedImageData(const QByteArray &buffer);
+    void slotReceivedImageData(const QByteArray &buffer, const drone::ImageFrameHeader &header);
 
 private slots:
     /// <summary>
@@ -70,6 +70,11 @@ protected:
     /// </summary>
     void keyPressEvent(QKeyEvent* event) override;
 
+    /// <summary>
+    /// Отпускание клавиш, для непрерывного управления
+    /// </summary>
+    void keyReleaseEvent(QKeyEvent* event) override;
+
 signals:
     /// <summary>
     /// Обработка нажатий кнопок на форме
@@ -83,6 +88,22 @@ signals:
     /// <param name="key">Код нажатой клавиши</param>
     void signalKeyPressed(const int &key);
 
+    /// <summary>
+    /// Отпускание клавиш
+    /// </summary>
+    /// <param name="key">Код отпущенной клавиши</param>
+    void signalKeyReleased(const int &key);
+
+    /// <summary>
+    /// Включение непрерывного управления
+    /// </summary>
+    void signalSetTeleop(const bool &enabled);
+
+    /// <summary>
+    /// Загрузка тестовой миссии
+    /// </summary>
+    void signalMissionBox();
+
     /// <summary>
     /// Установка параметров запроса
     /// </summary>
@@ -91,7 +112,9 @@ signals:
                          const float &speed,
                          const int &drivetrain,
                          const bool &get_image,
-                         const int &camera);
+                         const int &camera,
+                         const int &image_encoding,
+                         const int &vehicle_id);
 
     /// <summary>
     /// Установка параметров сохранения
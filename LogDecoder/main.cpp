@@ -0,0 +1,155 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AsyncLog.hpp"
+
+namespace
+{
+/// <summary>
+/// Место вызова из журнала
+/// </summary>
+struct Site
+{
+    drone::LogLevel level = drone::LogLevel::Info;
+    std::uint32_t line = 0;
+    std::string file;
+    std::string format;
+};
+
+void printUsage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options] <log file>\n"
+              << "  --level <level>  print only records at or above the level:\n"
+              << "                   trace, debug, info, warn, error (default: trace)\n"
+              << "  --no-source      do not print file:line of the call site\n";
+}
+
+/// <summary>
+/// Имя файла без каталогов
+/// </summary>
+std::string baseName(const std::string& path)
+{
+    const std::size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path;
+    drone::LogLevel min_level = drone::LogLevel::Trace;
+    bool print_source = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            if (!drone::parseLogLevel(argv[++i], min_level)) {
+                std::cerr << "Unknown level: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--no-source") == 0) {
+            print_source = false;
+        }
+        else if (argv[i][0] != '-' && path.empty()) {
+            path = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (path.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    const std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    drone::LogFileHeader header;
+    if (data.size() < sizeof(header)) {
+        std::cerr << "Not a drone log: " << path << "\n";
+        return 1;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, drone::LOG_FILE_MAGIC, sizeof(header.magic)) != 0 || header.header_size < sizeof(header)) {
+        std::cerr << "Not a drone log: " << path << "\n";
+        return 1;
+    }
+    if (header.version != drone::LOG_FILE_VERSION) {
+        std::cerr << "Unsupported log version " << header.version << "\n";
+        return 1;
+    }
+
+    // Сообщение может быть выгружено раньше своего места вызова,
+    // поэтому сначала читаются все места вызова, затем сообщения
+    std::map<std::uint32_t, Site> sites;
+    for (int pass = 0; pass < 2; ++pass) {
+        std::size_t offset = header.header_size;
+        while (offset + sizeof(drone::LogEntryHeader) <= data.size()) {
+            drone::LogEntryHeader entry;
+            std::memcpy(&entry, data.data() + offset, sizeof(entry));
+            offset += sizeof(entry);
+            if (offset + entry.size > data.size()) {
+                if (pass == 1) {
+                    std::cerr << "Truncated record at offset " << offset - sizeof(entry) << "\n";
+                }
+                break;
+            }
+            const char* body = data.data() + offset;
+            offset += entry.size;
+
+            if (pass == 0) {
+                if (entry.kind != drone::LogEntryKind::Site || entry.size < sizeof(drone::LogSiteEntry)) {
+                    continue;
+                }
+                drone::LogSiteEntry site_entry;
+                std::memcpy(&site_entry, body, sizeof(site_entry));
+                if (sizeof(site_entry) + site_entry.file_size + site_entry.format_size > entry.size) {
+                    continue;
+                }
+                Site& site = sites[site_entry.site_id];
+                site.level = site_entry.level;
+                site.line = site_entry.line;
+                site.file.assign(body + sizeof(site_entry), site_entry.file_size);
+                site.format.assign(body + sizeof(site_entry) + site_entry.file_size, site_entry.format_size);
+                continue;
+            }
+
+            if (entry.kind == drone::LogEntryKind::Record && entry.size >= sizeof(drone::LogRecordEntry)) {
+                drone::LogRecordEntry record;
+                std::memcpy(&record, body, sizeof(record));
+                if (record.level < min_level) {
+                    continue;
+                }
+                const auto it = sites.find(record.site_id);
+                const std::string message = drone::formatLogMessage(it != sites.end() ? it->second.format.c_str() : "<unknown site>",
+                                                                    reinterpret_cast<const std::byte*>(body + sizeof(record)),
+                                                                    entry.size - sizeof(record));
+                std::cout << drone::formatLogTime(header.start_time_ns + static_cast<std::int64_t>(record.time_ns))
+                          << ' ' << drone::logLevelName(record.level) << " [" << record.thread_id << "] " << message;
+                if (print_source && it != sites.end()) {
+                    std::cout << "  (" << baseName(it->second.file) << ':' << it->second.line << ')';
+                }
+                std::cout << '\n';
+            }
+            else if (entry.kind == drone::LogEntryKind::Dropped && entry.size >= sizeof(drone::LogDroppedEntry)) {
+                drone::LogDroppedEntry dropped;
+                std::memcpy(&dropped, body, sizeof(dropped));
+                std::cout << drone::formatLogTime(header.start_time_ns + static_cast<std::int64_t>(dropped.time_ns))
+                          << " WARN [" << dropped.thread_id << "] " << dropped.count << " records dropped: ring overflow\n";
+            }
+        }
+    }
+    return 0;
+}